@@ -8,7 +8,7 @@ QT       += core gui
 QT       -= opengl
 LIBS -= "-framework OpenGL"
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 TARGET = PSFEditor
 TEMPLATE = app
@@ -22,6 +22,8 @@ DEFINES += QT_NO_STYLE_GTK
 
 INCLUDEPATH += include/
 
+CONFIG += c++17
+
 # You can also make your code fail to compile if you use deprecated APIs.
 # In order to do so, uncomment the following line.
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
@@ -32,20 +34,73 @@ SOURCES += src/main.cpp\
         src/mainwindow.cpp \
     src/qfontglypheditor.cpp \
     src/qglyphlistwidgetitemdelegate.cpp \
+    src/qglyphlistmodel.cpp \
+    src/qfontsheetview.cpp \
+    src/qsampletextview.cpp \
+    src/fontatlas.cpp \
+    src/glyphchangebus.cpp \
+    src/glyphsimilarity.cpp \
     src/psfutil.cpp \
     src/psf.cpp \
+    src/psfbdf.cpp \
+    src/psfhex.cpp \
+    src/psfjournal.cpp \
+    src/psfcompiled.cpp \
+    src/psfsheet.cpp \
+    src/psfimage.cpp \
+    src/psfdiff.cpp \
+    src/psfconsole.cpp \
+    src/qglyphdiffview.cpp \
+    src/dlgfontdiff.cpp \
+    src/psfresize.cpp \
+    src/dlgrescale.cpp \
+    src/dlgrelayout.cpp \
+    src/psfrasterize.cpp \
+    src/dlgrasterize.cpp \
+    src/dlgspritesheet.cpp \
     src/dlgsymbinfo.cpp
 
 HEADERS  += include/mainwindow.h \
     include/qfontglypheditor.h \
     include/qglyphlistwidgetitemdelegate.h \
+    include/qglyphlistmodel.h \
+    include/qfontsheetview.h \
+    include/qsampletextview.h \
+    include/fontatlas.h \
+    include/glyphchangebus.h \
+    include/glyphsimilarity.h \
     include/psfutil.h \
     include/psf.h \
+    include/psfbdf.h \
+    include/psfhex.h \
+    include/psfjournal.h \
+    include/psfcompiled.h \
+    include/psfsheet.h \
+    include/psfimage.h \
+    include/psfdiff.h \
+    include/psfconsole.h \
+    include/qglyphdiffview.h \
+    include/dlgfontdiff.h \
+    include/psfresize.h \
+    include/dlgrescale.h \
+    include/dlgrelayout.h \
+    include/psfrasterize.h \
+    include/dlgrasterize.h \
+    include/dlgspritesheet.h \
+    include/psfmmap.h \
+    include/psfprogress.h \
+    include/psfparallel.h \
+    include/glyphview.h \
     include/mini_utf8.h \
     include/dlgsymbinfo.h
 
 FORMS    += ui/mainwindow.ui \
-    ui/dlgsymbinfo.ui
+    ui/dlgsymbinfo.ui \
+    ui/dlgspritesheet.ui \
+    ui/dlgfontdiff.ui \
+    ui/dlgrescale.ui \
+    ui/dlgrelayout.ui \
+    ui/dlgrasterize.ui
 
 RESOURCES += \
     rc/psfeditor.qrc
@@ -0,0 +1,34 @@
+#ifndef DLGFONTDIFF_H
+#define DLGFONTDIFF_H
+
+#include <QDialog>
+#include "psfdiff.h"
+
+namespace Ui {
+class DlgFontDiff;
+}
+
+/*
+ * Lists the glyphs that differ between two fonts and shows the selected
+ * one side by side. The fonts must outlive the dialog.
+ */
+class DlgFontDiff : public QDialog
+{
+    Q_OBJECT
+
+public:
+    DlgFontDiff(QWidget *parent, const PSFFont &a, const PSFFont &b, const PSFFontDiff &diff,
+                const QString &nameA, const QString &nameB);
+    ~DlgFontDiff();
+
+private slots:
+    void on_lstGlyphs_currentRowChanged(int row);
+
+private:
+    Ui::DlgFontDiff *ui;
+    const PSFFont &fontA;
+    const PSFFont &fontB;
+    const PSFFontDiff &diff;
+};
+
+#endif // DLGFONTDIFF_H
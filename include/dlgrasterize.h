@@ -0,0 +1,31 @@
+#ifndef DLGRASTERIZE_H
+#define DLGRASTERIZE_H
+
+#include <QDialog>
+#include <QFont>
+#include "psfrasterize.h"
+
+namespace Ui {
+class DlgRasterize;
+}
+
+class DlgRasterize : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DlgRasterize(QWidget *parent = nullptr);
+    ~DlgRasterize();
+
+    QFont getFont() const;
+    PSFRasterOptions getOptions() const;
+    QString getRanges() const;
+
+private slots:
+    void on_chkAntialias_toggled(bool checked);
+
+private:
+    Ui::DlgRasterize *ui;
+};
+
+#endif // DLGRASTERIZE_H
@@ -0,0 +1,39 @@
+#ifndef DLGRELAYOUT_H
+#define DLGRELAYOUT_H
+
+#include <QDialog>
+#include "psfresize.h"
+
+namespace Ui {
+class DlgRelayout;
+}
+
+/*
+ * Asks for a new glyph size and pixel shift. Shows the bounding box of the
+ * font and how much glyph memory the new size takes or saves.
+ */
+class DlgRelayout : public QDialog
+{
+    Q_OBJECT
+
+public:
+    DlgRelayout(QWidget *parent, const PSFFont &font, const PSFBoundingBox &bb);
+    ~DlgRelayout();
+
+    unsigned getWidth() const;
+    unsigned getHeight() const;
+    int getShiftX() const;
+    int getShiftY() const;
+
+private slots:
+    void on_btnAutoCrop_clicked();
+    void updateMemory();
+
+private:
+    Ui::DlgRelayout *ui;
+    PSFBoundingBox bbox;
+    unsigned numGlyphs;
+    unsigned glyphSize;
+};
+
+#endif // DLGRELAYOUT_H
@@ -0,0 +1,32 @@
+#ifndef DLGRESCALE_H
+#define DLGRESCALE_H
+
+#include <QDialog>
+#include "psfresize.h"
+
+namespace Ui {
+class DlgRescale;
+}
+
+class DlgRescale : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DlgRescale(QWidget *parent = nullptr, unsigned width = 8, unsigned height = 16);
+    ~DlgRescale();
+
+    PSFScaleMode getMode() const;
+    unsigned getWidth() const;
+    unsigned getHeight() const;
+    unsigned getCoverage() const;
+
+private slots:
+    void on_cmbMode_currentIndexChanged(int index);
+
+private:
+    Ui::DlgRescale *ui;
+    unsigned srcWidth, srcHeight;
+};
+
+#endif // DLGRESCALE_H
@@ -0,0 +1,29 @@
+#ifndef DLGSPRITESHEET_H
+#define DLGSPRITESHEET_H
+
+#include <QDialog>
+#include "psfsheet.h"
+
+namespace Ui {
+class DlgSpriteSheet;
+}
+
+class DlgSpriteSheet : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DlgSpriteSheet(QWidget *parent = nullptr, unsigned cellWidth = 8, unsigned cellHeight = 16);
+    ~DlgSpriteSheet();
+
+    PSFSheetLayout getLayout() const;
+    QString getCodepointFile() const;
+
+private slots:
+    void on_btnBrowse_clicked();
+
+private:
+    Ui::DlgSpriteSheet *ui;
+};
+
+#endif // DLGSPRITESHEET_H
@@ -0,0 +1,71 @@
+#ifndef FONTATLAS_H
+#define FONTATLAS_H
+
+#include <vector>
+#include <QImage>
+#include <QRect>
+#include "psf.h"
+
+/*
+ * Default number of glyph tiles per atlas row
+ */
+#define DEFAULT_ATLAS_COLUMNS 32
+
+/*
+ * A single monochrome image holding every glyph of a font laid out in a
+ * grid. Tiles are as high as the glyphs and as wide as the glyph rounded up
+ * to whole bytes, so a glyph row is copied with a single memcpy. The atlas
+ * remembers the generation of every tile and only re-renders the glyphs
+ * that changed.
+ */
+class FontAtlas
+{
+public:
+    FontAtlas();
+
+    /*
+     * Sets the font and renders the whole atlas.
+     */
+    void setFont(PSFFont *_font, int _columns = DEFAULT_ATLAS_COLUMNS);
+
+    /*
+     * Re-renders the tile of glyph <index> if it changed since the last time
+     * it was rendered.
+     *
+     * Returns:
+     *	true if the tile was rendered again, false otherwise.
+     */
+    bool updateGlyph(int index);
+
+    const QImage &image() const { return img; }
+    bool isNull() const { return font == nullptr || img.isNull(); }
+
+    int columns() const { return cols; }
+    int rows() const { return rowCount; }
+    int tileWidth() const { return tileW; }
+    int tileHeight() const { return tileH; }
+    int glyphCount() const { return static_cast<int>(generations.size()); }
+
+    /*
+     * Returns the rectangle of glyph <index> in atlas coordinates.
+     */
+    QRect tileRect(int index) const;
+
+    /*
+     * Returns the glyph at atlas position <pt>, or -1 if there is none.
+     */
+    int glyphAt(const QPoint &pt) const;
+
+private:
+    void renderGlyph(int index);
+
+private:
+    PSFFont *font;
+    QImage img;
+    int cols, rowCount;
+    int tileW, tileH;
+    uchar padMask;
+    std::vector<unsigned long> generations;
+};
+
+#endif // FONTATLAS_H
@@ -0,0 +1,43 @@
+#ifndef GLYPHCHANGEBUS_H
+#define GLYPHCHANGEBUS_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+/*
+ * Collects the indices of changed glyphs and delivers them in one
+ * glyphsChanged() signal per display frame, no matter how many edits
+ * happened in between.
+ */
+class GlyphChangeBus : public QObject
+{
+    Q_OBJECT
+public:
+    explicit GlyphChangeBus(QObject *parent = nullptr);
+
+public slots:
+    /*
+     * Marks glyph <index> as changed. The notification is delivered on the
+     * next frame.
+     */
+    void notify(int index);
+
+    /*
+     * Delivers the pending notifications right away.
+     */
+    void flush();
+
+signals:
+    /*
+     * Emitted at most once per frame with the sorted, unique indices of
+     * the glyphs changed since the previous emission.
+     */
+    void glyphsChanged(const QVector<int> &indices);
+
+private:
+    QTimer timer;
+    QVector<int> pending;
+};
+
+#endif // GLYPHCHANGEBUS_H
@@ -0,0 +1,62 @@
+#ifndef GLYPHSIMILARITY_H
+#define GLYPHSIMILARITY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "psf.h"
+
+struct GlyphMatch {
+    unsigned index;
+    unsigned distance; // differing pixels
+};
+
+/*
+ * Nearest neighbour index over the glyph bitmaps of a font, by Hamming
+ * distance. The bitmaps are packed back to back into a slab of 64 bit
+ * words, so a query is a parallel XOR + popcount scan that gives up on a
+ * glyph as soon as it is further than the current k-th best match.
+ *
+ * The index keeps a copy of the bitmaps: update() has to be called for
+ * the glyphs that change, and build() again when the font is replaced.
+ */
+class GlyphSimilarityIndex
+{
+public:
+    GlyphSimilarityIndex(): words(0), glyphsize(0), count(0) {}
+
+    /*
+     * Packs every glyph of <font>.
+     */
+    void build(const PSFFont& font);
+
+    /*
+     * Repacks glyph <index> of <font>, growing the index if the font grew.
+     */
+    void update(const PSFFont& font, unsigned index);
+
+    void clear();
+    bool isEmpty() const { return count == 0; }
+    unsigned size() const { return count; }
+
+    /* nearest()
+     *
+     * finds the <k> glyphs closest to the bitmap <bits> (glyph size bytes,
+     * as in PSFGlyph::getData()), skipping glyph <exclude> (-1 for none).
+     *
+     * Returns:
+     *	the matches sorted by distance, then by index.
+     */
+    std::vector<GlyphMatch> nearest(const unsigned char *bits, size_t k, int exclude = -1) const;
+
+private:
+    void pack(const PSFGlyph& glyph, uint64_t *dst) const;
+
+private:
+    std::vector<uint64_t> slab;
+    unsigned words;     // 64 bit words per glyph
+    unsigned glyphsize; // bytes per glyph
+    unsigned count;
+};
+
+#endif // GLYPHSIMILARITY_H
@@ -0,0 +1,194 @@
+#ifndef GLYPHVIEW_H
+#define GLYPHVIEW_H
+
+#include <cstdint>
+#include <type_traits>
+
+namespace PSF {
+
+/*
+ * Native row type of the glyph widths with a specialized view.
+ */
+template <unsigned Width> struct GlyphRow {};
+template <> struct GlyphRow<8> { typedef uint8_t type; };
+template <> struct GlyphRow<16> { typedef uint16_t type; };
+template <> struct GlyphRow<32> { typedef uint32_t type; };
+
+/*
+ * Access to a glyph bitmap (rows top to bottom, padded to whole bytes,
+ * leftmost pixel in the most significant bit) with the width known at
+ * compile time. A row is loaded as one native integer with the leftmost
+ * pixel in bit Width - 1, so strides and masks are constants.
+ *
+ * Byte is "const unsigned char" for read only views and "unsigned char"
+ * for views that can modify the bitmap.
+ */
+template <unsigned Width, typename Byte = const unsigned char>
+class GlyphView {
+public:
+    typedef typename GlyphRow<Width>::type Row;
+    static const unsigned ROW_BYTES = Width / 8;
+
+    GlyphView(Byte *data, unsigned width, unsigned height): data(data), h(height) { (void)width; }
+
+    unsigned width() const { return Width; }
+    unsigned height() const { return h; }
+    unsigned rowBytes() const { return ROW_BYTES; }
+
+    Row row(unsigned y) const {
+        const unsigned char *p = data + y * ROW_BYTES;
+        Row v = 0;
+        for (unsigned i = 0; i < ROW_BYTES; ++i) {
+            v = static_cast<Row>((v << 8) | p[i]);
+        }
+        return v;
+    }
+
+    void setRow(unsigned y, Row v) {
+        unsigned char *p = data + y * ROW_BYTES;
+        for (unsigned i = ROW_BYTES; i-- > 0; ) {
+            p[i] = static_cast<unsigned char>(v);
+            v = static_cast<Row>(v >> 8);
+        }
+    }
+
+    bool pixel(unsigned x, unsigned y) const {
+        return ((row(y) >> (Width - 1 - x)) & 1u) != 0;
+    }
+
+    void setPixel(unsigned x, unsigned y, bool val) {
+        unsigned char *p = data + y * ROW_BYTES + (x >> 3);
+        unsigned char mask = static_cast<unsigned char>(0x80 >> (x & 7));
+        *p = val ? (*p | mask) : (*p & ~mask);
+    }
+
+private:
+    Byte *data;
+    unsigned h;
+};
+
+/*
+ * Number of 64 bit words needed to hold a row of <width> pixels.
+ */
+inline unsigned rowWords(unsigned width)
+{
+    return (width + 63) / 64;
+}
+
+/*
+ * Fallback view for any other width, with runtime strides. Rows of any
+ * width can be read and written as multiword values, 64 pixels at a time.
+ */
+template <typename Byte>
+class GlyphView<0, Byte> {
+public:
+    GlyphView(Byte *data, unsigned width, unsigned height):
+        data(data), w(width), h(height), rb((width + 7) >> 3) {}
+
+    /*
+     * Stores row <y> into <words> (rowWords(width()) of them) as a right
+     * aligned value, least significant word first. The rightmost pixel is
+     * bit 0 of words[0].
+     */
+    void rowValue(unsigned y, uint64_t *words) const {
+        const unsigned char *p = data + y * rb;
+        unsigned n = rowWords(w);
+        unsigned pad = rb * 8 - w;
+
+        for (unsigned i = 0; i < n; ++i) {
+            unsigned stop = rb - 8 * i;
+            unsigned start = (stop > 8) ? stop - 8 : 0;
+            uint64_t v = 0;
+            for (unsigned b = start; b < stop; ++b) {
+                v = (v << 8) | p[b];
+            }
+            words[i] = v;
+        }
+        if (pad != 0) {
+            for (unsigned i = 0; i < n; ++i) {
+                uint64_t hi = (i + 1 < n) ? (words[i + 1] << (64 - pad)) : 0;
+                words[i] = (words[i] >> pad) | hi;
+            }
+        }
+    }
+
+    /*
+     * Sets row <y> from the right aligned value <words> (see rowValue()).
+     * Bits above width() are ignored.
+     */
+    void setRowValue(unsigned y, const uint64_t *words) {
+        unsigned char *p = data + y * rb;
+        unsigned n = rowWords(w);
+        unsigned pad = rb * 8 - w;
+
+        for (unsigned i = 0; i < n; ++i) {
+            uint64_t v = words[i] << pad;
+            if (pad != 0 && i > 0) {
+                v |= words[i - 1] >> (64 - pad);
+            }
+            unsigned stop = rb - 8 * i;
+            unsigned start = (stop > 8) ? stop - 8 : 0;
+            for (unsigned b = stop; b-- > start; ) {
+                p[b] = static_cast<unsigned char>(v);
+                v >>= 8;
+            }
+        }
+    }
+
+    unsigned width() const { return w; }
+    unsigned height() const { return h; }
+    unsigned rowBytes() const { return rb; }
+
+    bool pixel(unsigned x, unsigned y) const {
+        return (data[y * rb + (x >> 3)] & (0x80 >> (x & 7))) != 0;
+    }
+
+    void setPixel(unsigned x, unsigned y, bool val) {
+        unsigned char *p = data + y * rb + (x >> 3);
+        unsigned char mask = static_cast<unsigned char>(0x80 >> (x & 7));
+        *p = val ? (*p | mask) : (*p & ~mask);
+    }
+
+private:
+    Byte *data;
+    unsigned w, h, rb;
+};
+
+/*
+ * Width tag passed by dispatchGlyphWidth(). 0 selects the generic view.
+ */
+template <unsigned Width>
+using GlyphWidth = std::integral_constant<unsigned, Width>;
+
+/* dispatchGlyphWidth()
+ *
+ * calls fn(GlyphWidth<W>()) with W being <width> if there is a specialized
+ * view for it, or 0 otherwise. Meant to be called once per font or glyph,
+ * with the per row and per pixel work inside <fn>:
+ *
+ *	dispatchGlyphWidth(font.getWidth(), [&](auto tag) {
+ *	    GlyphView<decltype(tag)::value> view(data, width, height);
+ *	    ...
+ *	});
+ *
+ * Returns:
+ *	whatever <fn> returns.
+ */
+template <typename Fn>
+auto dispatchGlyphWidth(unsigned width, Fn&& fn) -> decltype(fn(GlyphWidth<0>()))
+{
+    switch (width) {
+    case 8:
+        return fn(GlyphWidth<8>());
+    case 16:
+        return fn(GlyphWidth<16>());
+    case 32:
+        return fn(GlyphWidth<32>());
+    default:
+        return fn(GlyphWidth<0>());
+    }
+}
+
+}
+
+#endif // GLYPHVIEW_H
@@ -2,17 +2,32 @@
 #define MAINWINDOW_H
 
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <vector>
 #include <QMainWindow>
-#include <QListWidgetItem>
+#include <QModelIndex>
+#include <QVector>
 #include <QFile>
+#include <QFutureWatcher>
+#include <QTimer>
 #include "psf.h"
 #include "psfutil.h"
+#include "psfjournal.h"
+#include "psfimage.h"
+#include "glyphsimilarity.h"
 
 namespace Ui {
 class MainWindow;
 }
 
+class QGlyphListModel;
+class QGlyphListWidgetItemDelegate;
+class GlyphChangeBus;
+class QProgressBar;
+class QToolButton;
+class QListWidgetItem;
+
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
@@ -23,20 +38,50 @@ public:
 
 private slots:
     void on_actionExitApp_triggered();
-    void on_listFontGlyphs_itemSelectionChanged();
+    void on_currentGlyphChanged(const QModelIndex &current);
     void on_actionOpenFontFile_triggered();
     void on_actionSaveFont_triggered();
     void on_actionExport_VerilogMIF_triggered();
     void on_actionExport_PSFFile_triggered();
-    void on_glyphChanged();
+    void on_actionExport_BDFFile_triggered();
+    void on_actionExport_HEXFile_triggered();
+    void on_actionExport_CompiledFont_triggered();
+    void on_actionExport_SpriteSheet_triggered();
+    void on_actionImport_SpriteSheet_triggered();
+    void on_actionCompareFont_triggered();
+    void on_actionFindSimilar_triggered();
+    void on_similarGlyphActivated(QListWidgetItem *item);
+    void on_actionRescaleFont_triggered();
+    void on_actionResizeCanvas_triggered();
+    void on_actionImport_SystemFont_triggered();
+    void on_glyphsChanged(const QVector<int> &indices);
+    void on_sheetGlyphClicked(int index);
+    void on_fontLoaded();
+    void on_loadProgressTimer();
+    void on_cancelLoading();
+    void on_fontSaved();
+    void on_journalCommitted();
     void on_actionCopy_glyph_triggered();
     void on_actionCut_glyph_triggered();
     void on_actionPaste_glyph_triggered();
+    void on_pasteModeChanged(QAction *action);
+    void on_actionPasteScale_toggled(bool checked);
 
 private:
+    void openFontFile(const QString &filePath);
     void updateGlyphListWidget();
     void updateFileInfo();
-    bool saveFontToFile();
+    void saveFontToFile();
+    void finishSave();
+    QString fontFilePath() const;
+    void waitForPendingSaves();
+    void openJournal(const QString &filePath);
+    void commitJournal();
+    void updateSimilarGlyphs();
+    void installResizedFont(PSFFont &resized);
+    void installNewFont(PSFFont &newFont, const QString &filePath, FileType type,
+                        std::shared_ptr<const PSFFont> base = nullptr);
+    void startLoading(const std::function<bool()> &loader, const QString &filePath, bool newFont);
 
 private:
     QString selectedFilter;
@@ -44,7 +89,41 @@ private:
     QFile currentFile;
     bool fileModified;
     Ui::MainWindow *ui;
+    QGlyphListModel *glyphModel;
+    QGlyphListWidgetItemDelegate *glyphDelegate;
+    GlyphChangeBus *changeBus;
     PSFFont font;
+    PSFImageOptions pasteOptions;
+    GlyphSimilarityIndex similarIndex;
+
+    // Background loading
+    PSFFont loadingFont;
+    std::shared_ptr<const PSFFont> loadingBase; // copy of loadingFont made by the loader
+    PSFProgress loadProgress;
+    QString loadingFilePath;
+    FileType loadingFileType;
+    bool loadingNewFont;
+    QFutureWatcher<bool> loadWatcher;
+    QTimer loadProgressTimer;
+    QProgressBar *loadProgressBar;
+    QToolButton *btnCancelLoad;
+
+    // Background saving
+    quint64 editGeneration;
+    quint64 savingGeneration;
+    QString savingFileName;
+    FileType savingFileType;
+    std::shared_ptr<const PSFFont> savingSnapshot;
+    std::shared_ptr<const PSFFont> snapshotBase; // older copy of the font the next snapshot is built from
+    QString cleanFileName; // PSF file the font was last loaded from or saved to
+    QString suggestedFilePath; // name offered when saving a font that has no file yet
+    bool saveQueued;
+    QFutureWatcher<bool> saveWatcher;
+
+    // Crash recovery journal
+    PSFJournal journal;
+    bool journalCommitQueued;
+    QFutureWatcher<bool> journalWatcher;
 };
 
 #endif // MAINWINDOW_H
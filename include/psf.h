@@ -14,8 +14,10 @@
 #ifndef psf_h
 #define psf_h
 
+#include <utility>
 #include <vector>
 #include <fstream>
+#include "psfprogress.h"
 
 /* this first part is copied more or less verbatim from th above source */
 
@@ -69,7 +71,7 @@ class PSFFont;
 class PSFGlyph {
     friend class PSFFont;
 public:
-    PSFGlyph(): font(nullptr) {}
+    PSFGlyph(): font(nullptr), generation(0), saved_generation(0) {}
 
     /* init()
      *
@@ -82,6 +84,7 @@ public:
     void init(PSFFont *font, std::vector<unsigned char>&& data) {
         this->font = font;
         this->data = std::move(data);
+        generation++;
     }
 
     /* init()
@@ -135,6 +138,35 @@ public:
      */
     const std::vector<unsigned int>& getUnicodeValues() const { return unicode_vals; }
 
+    /*
+     * Return the raw glyph bitmap. Rows are stored top to bottom, each one
+     * padded to a whole number of bytes with the leftmost pixel in the most
+     * significant bit.
+     *
+     * Returns:
+     *	the glyph bitmap data (empty if the glyph was never initialized)
+     */
+    const std::vector<unsigned char>& getData() const { return data; }
+
+    /*
+     * Return the edit generation of the glyph. It changes every time the
+     * glyph bitmap is modified, so it can be used to validate anything
+     * derived from the bitmap (thumbnails, caches).
+     *
+     * Returns:
+     *	the edit generation of the glyph
+     */
+    unsigned long getGeneration() const { return generation; }
+
+    /*
+     * Return true if the glyph bitmap changed since the font was last
+     * loaded or saved (see PSFFont::markSaved()).
+     *
+     * Returns:
+     *	true if the glyph bitmap was modified, false otherwise
+     */
+    bool isModified() const { return generation != saved_generation; }
+
     /*
      * Return the glyph width
      *
@@ -165,24 +197,49 @@ public:
      */
     bool addUnicodeVal(unsigned int uni);
 
+    /* clearUnicodeVals
+     *
+     * removes all the unicode values of the glyph. The font keeps its
+     * unicode table.
+     */
+    void clearUnicodeVals();
+
 private:
     PSFFont *font; // The font containing the glyph
     std::vector<unsigned char> data;
     std::vector<unsigned int> unicode_vals;
+    unsigned long generation;
+    unsigned long saved_generation;
 };
 
 enum class PSFVersion { V1, V2 };
 
+struct PSFFontChanges;
+
 /* representation of a complete psf font. */
 
 class PSFFont {
     friend class PSFGlyph;
 public:
-    PSFFont() {}
+    PSFFont(): version(PSFVersion::V2), header(), layout_generation(0), saved_layout_generation(0) {}
+
+    /*
+     * Copies a font. The glyphs of the copy belong to the copy.
+     */
+    PSFFont(const PSFFont& other);
+    PSFFont& operator=(const PSFFont& other);
+
+    /* swap()
+     *
+     * exchanges the contents of two fonts, keeping every glyph attached to
+     * the font that now holds it. References to the font objects themselves
+     * stay valid, references to their glyphs do not.
+     */
+    void swap(PSFFont& other);
 
     /*
-     * Initializes a new psf font. Based upon the version,
-     * the following applies:
+     * Initializes a new psf font, dropping any glyphs and unicode table
+     * it had. Based upon the version, the following applies:
      * 	if version==1:
      *		width must be 8
      *		charsize is precomputed as height
@@ -205,7 +262,7 @@ public:
      * Returns:
      *	the width of the font
      */
-    unsigned int getWidth() {
+    unsigned int getWidth() const {
         return ((version == PSFVersion::V1) ? 8 : header.psf2.width);
     }
 
@@ -215,7 +272,7 @@ public:
      * Returns:
      *	the height of the font
      */
-    unsigned int getHeight() {
+    unsigned int getHeight() const {
         return ((version == PSFVersion::V1) ? header.psf1.charsize : header.psf2.height);
     }
 
@@ -255,7 +312,7 @@ public:
      * Returns:
      *	true if the psf font uses version 2, false otherwise
      */
-    bool isVersion2() { return version == PSFVersion::V2; }
+    bool isVersion2() const { return version == PSFVersion::V2; }
 
     /* loadFromFile()
      *
@@ -263,12 +320,12 @@ public:
      *
      * Arguments:
      *	file	the file handle to load the font from
+     *	progress	optional progress and cancellation state
      *
      * Returns:
-     *	a pointer to a psf_font structure containing the loaded font, or 0 on
-     *	error.
+     *	true on success, false on error or if loading was canceled.
      */
-    bool loadFromFile(std::ifstream& file);
+    bool loadFromFile(std::ifstream& file, PSFProgress *progress = nullptr);
 
     /* loadFromFile()
      *
@@ -276,24 +333,24 @@ public:
      *
      * Arguments:
      *	filename	the name of the file to load the font from
+     *	progress	optional progress and cancellation state
      *
      * Returns:
-     *	a pointer to a psf_font structure containing the loaded font, or 0 on
-     *	error.
+     *	true on success, false on error or if loading was canceled.
      */
-    bool loadFromFile(const char *filename);
+    bool loadFromFile(const char *filename, PSFProgress *progress = nullptr);
 
     /* saveToFile()
      *
-     * saves a psf_font structure to a psf font file handle
+     * saves a psf_font structure to an output stream
      *
      * Arguments:
-     *	file	the file handle to save to
+     *	file	the stream to save to, a file or a memory buffer
      *
      * Returns:
      *	true on success, false on failure.
      */
-    bool saveToFile(std::ofstream& file) const {
+    bool saveToFile(std::ostream& file) const {
         if (version == PSFVersion::V1) {
             return psf1SaveToFile(file);
         } else {
@@ -313,6 +370,72 @@ public:
      */
     bool saveToFile(const char *filename) const;
 
+    /* saveChangesToFile()
+     *
+     * updates a psf font file this font was loaded from or last saved to.
+     * If only glyph bitmaps changed since then (see markSaved()) and the
+     * header on disk still matches the font, just the modified glyphs are
+     * written in place. Otherwise the whole font is written to a temporary
+     * file next to the file <filename> resolves to. The temporary file gets
+     * the mode of the old one and is synced before it replaces it, then the
+     * directory is synced, so a crash leaves either the old or the new font.
+     *
+     * Arguments:
+     *	filename	the name of the file to update
+     *
+     * Returns:
+     *	true on success, false on failure.
+     */
+    bool saveChangesToFile(const char *filename) const;
+
+    /* markSaved()
+     *
+     * records <saved> as the state of the font on disk. <saved> is either
+     * this font or a copy of it taken before writing the file; glyphs edited
+     * after the copy was taken stay modified.
+     */
+    void markSaved(const PSFFont& saved);
+
+    /* markClean()
+     *
+     * records the current state of the font as the state on disk.
+     */
+    void markClean() { markSaved(*this); }
+
+    /* isLayoutModified()
+     *
+     * checks whether the font dimensions, the amount of glyphs or the
+     * unicode table changed since the font was last loaded or saved.
+     *
+     * Returns:
+     *	true if the file layout changed, false if only bitmaps did.
+     */
+    bool isLayoutModified() const { return layout_generation != saved_layout_generation; }
+
+    /* getChangesSince()
+     *
+     * collects what changed in this font since <base>, an older copy of it,
+     * was taken: the header, the glyphs edited since and the glyphs added
+     * after. Glyph bitmaps are only compared by generation, so this costs
+     * little more than copying the changed glyphs.
+     *
+     * Arguments:
+     *	base	an older copy of this font
+     *	changes	filled with the changes
+     *
+     * Returns:
+     *	true on success, false if the font lost glyphs or got other glyph
+     *	dimensions since <base> was taken.
+     */
+    bool getChangesSince(const PSFFont& base, PSFFontChanges& changes) const;
+
+    /* applyChanges()
+     *
+     * brings this font, a copy of the <base> passed to getChangesSince(), up
+     * to date with the changes it collected. <changes> is left empty.
+     */
+    void applyChanges(PSFFontChanges&& changes);
+
     /* getGlyph
      *
      * returns a reference to a glyph within a psf font
@@ -364,7 +487,7 @@ public:
      * Returns:
      *	true if the font has an unicode table, false if not.
      */
-    bool hasUnicodeTable() {
+    bool hasUnicodeTable() const {
         if (version == PSFVersion::V1) {
             return (header.psf1.mode & PSF1_MODEHASTAB) != 0;
         } else {
@@ -373,19 +496,22 @@ public:
     }
 
 private:
-    bool readGlyphs(std::ifstream& file, unsigned int numglyphs, unsigned int glyphsize);
+    bool readGlyphs(std::ifstream& file, unsigned int numglyphs, unsigned int glyphsize, PSFProgress *progress);
     bool psf1ReadUnicodeVals(std::ifstream& file, unsigned int numglyphs);
-    bool psf1LoadFromFile(std::ifstream& file);
-    bool psf1WriteUnicodeVals(std::ofstream& file) const;
-    bool psf1SaveToFile(std::ofstream& file) const;
+    bool psf1LoadFromFile(std::ifstream& file, PSFProgress *progress);
+    bool psf1WriteUnicodeVals(std::ostream& file) const;
+    bool psf1SaveToFile(std::ostream& file) const;
     bool psf2ReadRemainingFile(std::ifstream& file, std::vector<unsigned char>& data);
     bool psf2ReadUnicodeVals(std::ifstream& file, unsigned int numglyphs);
-    bool psf2LoadFromFile(std::ifstream& file);
-    bool psf2WriteUnicodeVals(std::ofstream& file) const;
-    bool psf2SaveToFile(std::ofstream& file) const;
-    bool writeDummy(std::ofstream& file, unsigned int size) const;
-    bool writeGlyphs(std::ofstream& file) const;
+    bool psf2LoadFromFile(std::ifstream& file, PSFProgress *progress);
+    bool psf2WriteUnicodeVals(std::ostream& file) const;
+    bool psf2SaveToFile(std::ostream& file) const;
+    bool writeDummy(std::ostream& file, unsigned int size) const;
+    bool writeGlyphs(std::ostream& file) const;
+    std::vector<unsigned char> headerBytes() const;
+    bool writeModifiedGlyphs(const char *filename) const;
     void resizeGlyphVector(unsigned int num);
+    void attachGlyphs();
 
 private:
     PSFVersion version;
@@ -396,6 +522,20 @@ private:
 	} header;
 
     std::vector<PSFGlyph> glyphv;
+
+    // Changes whenever the header or the unicode table change
+    unsigned long layout_generation;
+    unsigned long saved_layout_generation;
+};
+
+/*
+ * Changes of a font since an older copy of it was taken, see
+ * PSFFont::getChangesSince().
+ */
+struct PSFFontChanges {
+    PSFFont layout;     // version, header and unicode table state, no glyphs
+    unsigned int numGlyphs = 0;
+    std::vector<std::pair<unsigned int, PSFGlyph>> glyphs;
 };
 
 #endif /* psf_h */
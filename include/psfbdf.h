@@ -0,0 +1,34 @@
+#ifndef PSFBDF_H
+#define PSFBDF_H
+
+#include <string>
+#include "psf.h"
+#include "psfprogress.h"
+
+namespace PSF {
+    /* loadFromBdf()
+     *
+     * loads a BDF (Glyph Bitmap Distribution Format) font into a PSF2 font.
+     * The cell size is taken from FONTBOUNDINGBOX and every glyph bitmap is
+     * placed into the cell according to its own BBX. Glyphs keep the file
+     * order, and non negative ENCODING values go to the unicode table.
+     * <progress> (optional) is advanced once per glyph.
+     *
+     * Returns:
+     *	true on success, false on failure or if loading was canceled.
+     */
+    bool loadFromBdf(PSFFont& font, const std::string& filename, PSFProgress *progress = nullptr);
+
+    /* saveToBdf()
+     *
+     * saves a font as a BDF 2.1 file. Each glyph is encoded with its first
+     * unicode value, or with its index if the font has no unicode table.
+     * PSF fonts carry no baseline, so the whole cell is written as ascent.
+     *
+     * Returns:
+     *	true on success, false on failure.
+     */
+    bool saveToBdf(const PSFFont& font, const std::string& filename);
+}
+
+#endif // PSFBDF_H
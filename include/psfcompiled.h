@@ -0,0 +1,150 @@
+#ifndef PSFCOMPILED_H
+#define PSFCOMPILED_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "psf.h"
+#include "psfmmap.h"
+
+/*
+ * Compiled font blob (.psfc). A font laid out so it can be memory mapped
+ * and used without any parsing or allocation:
+ *
+ *	header		64 bytes, see PSFCompiledHeader
+ *	glyph slab	64 byte aligned, glyph bitmaps back to back (charsize
+ *			bytes each, rows padded to whole bytes, MSB first)
+ *	code points	sorted { code point, glyph } pairs
+ *	sequences	{ pool offset, length, glyph } entries sorted by sequence,
+ *			followed by the pool of code points they point to
+ *
+ * All the fields use the byte order of the machine that wrote the blob, a
+ * blob from a machine with a different byte order is rejected.
+ */
+
+#define PSFC_MAGIC      "PSFC"
+#define PSFC_VERSION    1
+#define PSFC_BYTE_ORDER 0x01020304u
+#define PSFC_ALIGN      64
+
+/* bits used in flags */
+#define PSFC_HAS_UNICODE_TABLE 0x01
+
+struct PSFCompiledHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;     /* PSFC_BYTE_ORDER as written by the producer */
+    uint32_t flags;
+    uint32_t width, height;
+    uint32_t rowBytes;      /* bytes per glyph row */
+    uint32_t charsize;      /* bytes per glyph */
+    uint32_t numGlyphs;
+    uint32_t numCodepoints; /* entries in the code point table */
+    uint32_t numSequences;  /* entries in the sequence table */
+    uint32_t seqPoolSize;   /* code points in the sequence pool */
+    uint32_t glyphOffset;   /* offsets from the start of the blob */
+    uint32_t cpOffset;
+    uint32_t seqOffset;
+    uint32_t fileSize;
+};
+
+static_assert(sizeof(PSFCompiledHeader) == 64, "compiled font header must be 64 bytes");
+
+struct PSFCompiledCodepoint {
+    uint32_t codepoint;
+    uint32_t glyph;
+};
+
+struct PSFCompiledSequence {
+    uint32_t offset;        /* index of the first code point in the pool */
+    uint32_t length;
+    uint32_t glyph;
+};
+
+/*
+ * Read only view of a compiled font blob, backed by a memory mapping. The
+ * accessors point straight into the mapping.
+ */
+class PSFCompiledFont {
+public:
+    PSFCompiledFont(): hdr(nullptr), base(nullptr), cps(nullptr), seqs(nullptr), pool(nullptr) {}
+
+    /* open()
+     *
+     * maps and validates the compiled font <filename>.
+     *
+     * Returns:
+     *	true on success, false on failure.
+     */
+    bool open(const char *filename);
+    void close();
+
+    unsigned int getWidth() const { return hdr->width; }
+    unsigned int getHeight() const { return hdr->height; }
+    unsigned int getRowBytes() const { return hdr->rowBytes; }
+    unsigned int getGlyphSize() const { return hdr->charsize; }
+    unsigned int getNumGlyphs() const { return hdr->numGlyphs; }
+    bool hasUnicodeTable() const { return (hdr->flags & PSFC_HAS_UNICODE_TABLE) != 0; }
+
+    /*
+     * Returns the bitmap of glyph <no>, which must be less than
+     * getNumGlyphs().
+     */
+    const unsigned char *getGlyph(unsigned int no) const {
+        return base + hdr->glyphOffset + static_cast<size_t>(no) * hdr->charsize;
+    }
+
+    /* findGlyph()
+     *
+     * looks up the glyph of a code point with a binary search.
+     *
+     * Returns:
+     *	the glyph index, or -1 if no glyph is mapped to <codepoint>.
+     */
+    long findGlyph(uint32_t codepoint) const;
+
+    /* findSequence()
+     *
+     * looks up the glyph of the code point sequence <seq> of length <len>.
+     *
+     * Returns:
+     *	the glyph index, or -1 if no glyph is mapped to the sequence.
+     */
+    long findSequence(const uint32_t *seq, size_t len) const;
+
+    const PSFCompiledHeader& header() const { return *hdr; }
+    const PSFCompiledCodepoint *codepoints() const { return cps; }
+    const PSFCompiledSequence *sequences() const { return seqs; }
+    const uint32_t *sequencePool() const { return pool; }
+
+private:
+    PSFMappedFile file;
+    const PSFCompiledHeader *hdr;
+    const unsigned char *base;
+    const PSFCompiledCodepoint *cps;
+    const PSFCompiledSequence *seqs;
+    const uint32_t *pool;
+};
+
+namespace PSF {
+    /* saveToCompiled()
+     *
+     * saves a font as a compiled font blob.
+     *
+     * Returns:
+     *	true on success, false on failure.
+     */
+    bool saveToCompiled(const PSFFont& font, const std::string& filename);
+
+    /* loadFromCompiled()
+     *
+     * loads a compiled font blob into a PSF2 font. Every glyph gets its
+     * code points in ascending order, followed by its sequences.
+     *
+     * Returns:
+     *	true on success, false on failure.
+     */
+    bool loadFromCompiled(PSFFont& font, const std::string& filename);
+}
+
+#endif // PSFCOMPILED_H
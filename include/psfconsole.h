@@ -0,0 +1,161 @@
+#ifndef PSFCONSOLE_H
+#define PSFCONSOLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "psf.h"
+
+/* bits used in PSFCell::flags */
+#define PSF_CELL_WIDE       0x01 /* first half of a double width character */
+#define PSF_CELL_WIDE_TRAIL 0x02 /* second half, drawn with the first one */
+#define PSF_CELL_WIDE_FONT  0x04 /* glyph is in the wide font */
+
+/*
+ * One character cell of a console. Colors are palette indices.
+ */
+struct PSFCell {
+    uint32_t codepoint;
+    uint32_t glyph;  /* glyph the code point maps to, set by the console */
+    uint8_t fg;
+    uint8_t bg;
+    uint8_t flags;
+};
+
+/*
+ * Text console drawn with a PSF font into a 32 bit (0x00RRGGBB) pixel
+ * buffer owned by the caller. The console keeps a grid of cells and tracks
+ * the ones that changed, so render() only draws those. Scrolling moves the
+ * cells and the already drawn scanlines instead of drawing them again.
+ *
+ * Double width characters take two cells. They are drawn from the wide
+ * font if there is one (glyphs twice as wide as the narrow font, same
+ * height), otherwise their narrow glyph is stretched to two cells.
+ *
+ * The console copies the bitmaps of the fonts when it is created, later
+ * changes to the fonts are not seen.
+ */
+class PSFConsole {
+public:
+    PSFConsole(const PSFFont& font, unsigned columns, unsigned rows, const PSFFont *wideFont = nullptr);
+
+    unsigned columns() const { return cols; }
+    unsigned rows() const { return nrows; }
+    unsigned cellWidth() const { return cellW; }
+    unsigned cellHeight() const { return cellH; }
+    unsigned pixelWidth() const { return cols * cellW; }
+    unsigned pixelHeight() const { return nrows * cellH; }
+
+    const PSFCell& cell(unsigned x, unsigned y) const { return grid[static_cast<size_t>(y) * cols + x]; }
+
+    /* setCell()
+     *
+     * puts <codepoint> at column <x> of row <y>. A double width character
+     * also takes the next cell, or is replaced by U+FFFD in the last
+     * column. Overwriting half of a double width character blanks the
+     * other half. Cells that do not change are not marked dirty.
+     *
+     * Returns:
+     *	the number of cells taken, 1 or 2.
+     */
+    unsigned setCell(unsigned x, unsigned y, uint32_t codepoint, uint8_t fg, uint8_t bg);
+
+    /* putText()
+     *
+     * writes the UTF-8 string <text> from column <x> of row <y>, stopping
+     * at the end of the row. Invalid sequences show as U+FFFD.
+     *
+     * Returns:
+     *	the column after the last character written.
+     */
+    unsigned putText(unsigned x, unsigned y, const char *text, uint8_t fg, uint8_t bg);
+
+    /* scrollUp()
+     *
+     * moves every row <lines> rows up and fills the rows uncovered at the
+     * bottom with blanks in color <bg>. The next render() moves the pixels
+     * of the rows that are kept and only draws the new ones.
+     */
+    void scrollUp(unsigned lines, uint8_t bg);
+
+    /* clear()
+     *
+     * fills every cell with a blank in color <bg>.
+     */
+    void clear(uint8_t bg);
+
+    /*
+     * Sets palette entry <index> to <rgb> (0x00RRGGBB). The first 16 entries
+     * start with the VGA colors, the rest with the xterm 256 color palette.
+     */
+    void setPalette(uint8_t index, uint32_t rgb);
+
+    /*
+     * Marks the whole console as dirty, for when the pixel buffer does not
+     * hold the last frame drawn (a new buffer, or one drawn over).
+     */
+    void invalidate() { fullRedraw = true; }
+
+    bool isDirty() const { return fullRedraw || pendingScroll != 0 || dirtyRows != 0; }
+
+    /* render()
+     *
+     * brings the pixel buffer up to date: applies the pending scroll and
+     * draws the dirty cells. <pixels> must hold pixelWidth() x pixelHeight()
+     * pixels, <pitch> is the distance between scanlines in bytes. Unless
+     * invalidate() was called, the buffer must hold the frame drawn by the
+     * previous render().
+     *
+     * Returns:
+     *	the number of cells drawn.
+     */
+    unsigned render(uint32_t *pixels, size_t pitch);
+
+    /* isWide()
+     *
+     * checks whether <codepoint> is a double width (East Asian wide or
+     * fullwidth) character.
+     */
+    static bool isWide(uint32_t codepoint);
+
+private:
+    struct GlyphSet {
+        unsigned width = 0;
+        unsigned rowBytes = 0;
+        unsigned glyphSize = 0;
+        unsigned numGlyphs = 0;
+        std::vector<unsigned char> bitmaps;              // glyphs back to back
+        std::vector<std::pair<uint32_t, uint32_t>> map;  // sorted { code point, glyph }
+        bool byIndex = false;                            // no unicode table, code page order
+
+        void load(const PSFFont& font);
+        long find(uint32_t codepoint) const;
+        const unsigned char *glyph(uint32_t index) const { return &bitmaps[static_cast<size_t>(index) * glyphSize]; }
+    };
+
+    PSFCell makeCell(uint32_t codepoint, uint8_t fg, uint8_t bg, bool doubleWidth) const;
+    PSFCell blankCell(uint8_t fg, uint8_t bg) const { return PSFCell{' ', blankGlyph, fg, bg, 0}; }
+    void store(unsigned x, unsigned y, const PSFCell& c);
+    void assign(unsigned x, unsigned y, const PSFCell& c);
+    void markDirty(unsigned x, unsigned y);
+    void drawCell(const PSFCell& c, unsigned y, uint32_t *dst) const;
+
+private:
+    unsigned cols, nrows;
+    unsigned cellW, cellH;
+    GlyphSet narrow;
+    GlyphSet wide;
+    uint32_t fallback;                // narrow glyph shown for unmapped code points
+    uint32_t blankGlyph;              // narrow glyph of blank cells
+    uint32_t palette[256];
+    std::vector<PSFCell> grid;
+    std::vector<uint8_t> dirty;       // per cell
+    std::vector<uint8_t> rowDirty;    // per row, any cell of the row is dirty
+    unsigned dirtyRows;
+    unsigned pendingScroll;           // rows scrolled since the last render()
+    bool fullRedraw;
+    std::vector<unsigned> drawList;   // dirty cells of the row being drawn
+};
+
+#endif // PSFCONSOLE_H
@@ -0,0 +1,66 @@
+#ifndef PSFDIFF_H
+#define PSFDIFF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "psf.h"
+
+enum class PSFDiffKind : unsigned char {
+    Changed, // in both fonts, with a different bitmap and/or unicode values
+    Added,   // only in the second font
+    Removed  // only in the first font
+};
+
+struct PSFGlyphDiff {
+    unsigned index;
+    PSFDiffKind kind;
+    unsigned pixels;     // differing pixels (set pixels for added/removed glyphs)
+    bool unicodeChanged; // the unicode values differ
+};
+
+struct PSFFontDiff {
+    std::vector<PSFGlyphDiff> glyphs; // differing glyphs, by index
+    unsigned changed = 0;
+    unsigned added = 0;
+    unsigned removed = 0;
+    unsigned unicodeChanged = 0;
+    uint64_t pixels = 0;
+
+    bool identical() const { return glyphs.empty(); }
+};
+
+namespace PSF {
+    /* diffBitmaps()
+     *
+     * XORs the <size> byte bitmaps <a> and <b> a 64 bit word at a time. If
+     * <mask> is not null, the XOR is stored there (set bits are the pixels
+     * that differ).
+     *
+     * Returns:
+     *	the number of differing pixels.
+     */
+    unsigned diffBitmaps(const unsigned char *a, const unsigned char *b, size_t size, unsigned char *mask = nullptr);
+
+    /* diffGlyphs()
+     *
+     * compares the bitmaps of two glyphs of the same size. Glyphs that were
+     * never initialized count as empty.
+     *
+     * Returns:
+     *	the number of differing pixels, <mask> (optional) gets the XOR.
+     */
+    unsigned diffGlyphs(const PSFGlyph& a, const PSFGlyph& b, std::vector<unsigned char> *mask = nullptr);
+
+    /* diffFonts()
+     *
+     * compares every glyph of <a> and <b> (bitmaps and unicode values), in
+     * parallel, and fills <diff> with the glyphs that differ.
+     *
+     * Returns:
+     *	true on success, false if the glyph sizes of the fonts differ.
+     */
+    bool diffFonts(const PSFFont& a, const PSFFont& b, PSFFontDiff& diff);
+}
+
+#endif // PSFDIFF_H
@@ -0,0 +1,35 @@
+#ifndef PSFHEX_H
+#define PSFHEX_H
+
+#include <string>
+#include "psf.h"
+#include "psfprogress.h"
+
+namespace PSF {
+    /* loadFromUnifontHex()
+     *
+     * loads a GNU Unifont .hex file (one "CODEPOINT:BITMAP" line per glyph,
+     * 16 rows high) into a PSF2 font. The font is as wide as the widest
+     * glyph in the file, narrower glyphs are left aligned. Every glyph gets
+     * its code point in the unicode table. <progress> (optional) counts
+     * the bytes parsed by both passes.
+     *
+     * Returns:
+     *	true on success, false on failure or if loading was canceled.
+     */
+    bool loadFromUnifontHex(PSFFont& font, const std::string& filename, PSFProgress *progress = nullptr);
+
+    /* saveToUnifontHex()
+     *
+     * saves a 16 pixel high font as a .hex file, one line per unicode value
+     * sorted by code point. Fonts without unicode table use the glyph index
+     * as code point. In fonts wider than 8 pixels, glyphs whose right part
+     * is empty are written as 8 pixel wide glyphs.
+     *
+     * Returns:
+     *	true on success, false on failure.
+     */
+    bool saveToUnifontHex(const PSFFont& font, const std::string& filename);
+}
+
+#endif // PSFHEX_H
@@ -0,0 +1,70 @@
+#ifndef PSFIMAGE_H
+#define PSFIMAGE_H
+
+#include <QImage>
+#include <QRect>
+#include "psf.h"
+
+/*
+ * How grey levels become set or unset glyph pixels.
+ */
+enum class PSFBinarize {
+    Fixed,          // darker than a fixed threshold
+    Otsu,           // darker than the threshold that best splits the histogram
+    FloydSteinberg, // error diffusion, keeps the tone of anti aliased edges
+    Ordered         // 8x8 Bayer matrix dither
+};
+
+struct PSFImageOptions {
+    PSFBinarize mode = PSFBinarize::Fixed;
+    int threshold = 128;    // used by PSFBinarize::Fixed
+    bool scale = false;     // scale the image to the glyph size first
+    bool keepAspect = true; // when scaling, keep the aspect ratio
+};
+
+namespace PSF {
+    /* toGray8()
+     *
+     * converts an image to 8 bit luminance (BT.601 weights) in one pass,
+     * using SSE2 where available. Pixels with alpha below 128 become white.
+     */
+    QImage toGray8(const QImage& img);
+
+    /* otsuThreshold()
+     *
+     * computes the threshold that best separates the grey levels of <rect>
+     * of the Format_Grayscale8 image <gray> into two classes.
+     *
+     * Returns:
+     *	the threshold, pixels below it are the dark class.
+     */
+    int otsuThreshold(const QImage& gray, const QRect& rect);
+
+    /* thresholdRow()
+     *
+     * packs <width> grey levels into a glyph row (MSB first), setting the
+     * pixels darker than <threshold>. Works 16 pixels at a time with SSE2.
+     */
+    void thresholdRow(const uchar *gray, unsigned width, int threshold, unsigned char *row);
+
+    /* binarize()
+     *
+     * converts the <w> x <h> area of <gray> at (<x0>, <y0>) into glyph rows
+     * of <rowBytes> bytes at <bits>, using the mode in <opt>.
+     */
+    void binarize(const QImage& gray, int x0, int y0, unsigned w, unsigned h,
+                  const PSFImageOptions& opt, unsigned char *bits, unsigned rowBytes);
+
+    /* setGlyphFromImage()
+     *
+     * draws <img> into the top left corner of the glyph, cropped or (with
+     * opt.scale) scaled to the glyph size. Pixels outside the image keep
+     * their value.
+     *
+     * Returns:
+     *	true on success, false if the image is empty.
+     */
+    bool setGlyphFromImage(PSFGlyph& glyph, const QImage& img, const PSFImageOptions& opt);
+}
+
+#endif // PSFIMAGE_H
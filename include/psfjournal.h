@@ -0,0 +1,144 @@
+#ifndef PSFJOURNAL_H
+#define PSFJOURNAL_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include "psf.h"
+
+/*
+ * Largest glyph count a journal may grow a PSF2 font to
+ */
+#define PSF_MAX_JOURNAL_GLYPHS 0x110000
+
+/*
+ * Append only edit journal kept next to a font file (<font>.journal). Every
+ * change to a glyph is appended as a small record: the XOR of the old and
+ * new bitmap trimmed to the bytes that differ, the new unicode values of
+ * the glyph, or the new glyph count when the font grew. Records are
+ * buffered by record() and made durable in groups by commit(), so an
+ * editor crash loses at most the last group.
+ *
+ * Replaying the journal onto the font file it belongs to restores the edits
+ * made since the file was last saved. After a successful save rebase()
+ * starts the journal over from the saved font.
+ *
+ * record() and commit() may run on different threads, everything else must
+ * not run concurrently with commit().
+ */
+class PSFJournal {
+public:
+    PSFJournal(): fd(-1), glyphsize(0), committedLength(0) {}
+    ~PSFJournal() { close(); }
+
+    PSFJournal(const PSFJournal&) = delete;
+    PSFJournal& operator=(const PSFJournal&) = delete;
+
+    /* journalPath()
+     *
+     * Returns:
+     *	the name of the journal belonging to the font file <fontFile>.
+     */
+    static std::string journalPath(const std::string& fontFile) { return fontFile + ".journal"; }
+
+    /* hasRecords()
+     *
+     * checks whether the font file <fontFile> has a journal with at least
+     * one valid record.
+     *
+     * Returns:
+     *	true if there are edits to replay, false if not.
+     */
+    static bool hasRecords(const std::string& fontFile);
+
+    /* replay()
+     *
+     * applies the journal of <fontFile> to <font> in a single pass. <font>
+     * must hold the contents of <fontFile> and grows if glyphs were added.
+     * A torn tail left by a crash is reported and ignored, so the edits up
+     * to the last commit are restored. A record that does not fit the font
+     * fails the whole replay and leaves <font> untouched.
+     *
+     * Arguments:
+     *	font		the font loaded from <fontFile>
+     *	fontFile	the font file name
+     *	applied		(optional) set to the amount of records applied
+     *
+     * Returns:
+     *	true on success, false if the journal cannot be read or does not
+     *	match the font.
+     */
+    static bool replay(PSFFont& font, const std::string& fontFile, size_t *applied = nullptr);
+
+    /* open()
+     *
+     * starts journaling edits of <font>, which was loaded from <fontFile>.
+     * With <append> the records already in the journal are kept (they must
+     * have been replayed onto <font>), otherwise the journal is emptied.
+     *
+     * Returns:
+     *	true on success, false on failure.
+     */
+    bool open(const std::string& fontFile, const PSFFont& font, bool append);
+
+    /* record()
+     *
+     * queues records for whatever changed in glyph <index> since it was
+     * last recorded. Nothing is queued for unchanged glyphs.
+     */
+    void record(unsigned int index, const PSFGlyph& glyph);
+
+    /* commit()
+     *
+     * appends the queued records to the journal and flushes them to disk.
+     * On failure the journal is cut back to the last commit and the records
+     * stay queued for the next one.
+     *
+     * Returns:
+     *	true on success, false on failure.
+     */
+    bool commit();
+
+    /* rebase()
+     *
+     * starts the journal over after <saved>, a snapshot of the font, was
+     * written to <fontFile>. Edits made to <current> after the snapshot was
+     * taken are queued again relative to <saved>, for the next commit(). All
+     * edits of <current> must have been recorded; then only the glyphs whose
+     * generation differs from <saved> are compared. If <fontFile> changed,
+     * the old journal is removed.
+     *
+     * Returns:
+     *	true on success, false on failure.
+     */
+    bool rebase(const std::string& fontFile, const PSFFont& saved, const PSFFont& current);
+
+    /* remove()
+     *
+     * closes and deletes the journal, dropping any queued records.
+     */
+    void remove();
+
+    void close();
+    bool isOpen() const { return fd >= 0; }
+
+private:
+    void setBase(const PSFFont& font);
+    bool openFile(const std::string& fontFile, unsigned int size, bool append);
+
+private:
+    int fd;
+    std::string path;
+    unsigned int glyphsize;
+    off_t committedLength; // end of the last record flushed to disk
+
+    // Glyph state as of the last record, the base for the next XOR delta
+    std::vector<std::vector<unsigned char>> bitmaps;
+    std::vector<std::vector<unsigned int>> unicodes;
+
+    std::mutex pendingMutex;
+    std::vector<unsigned char> pending;
+};
+
+#endif // PSFJOURNAL_H
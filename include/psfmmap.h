@@ -0,0 +1,76 @@
+#ifndef PSFMMAP_H
+#define PSFMMAP_H
+
+#include <cstddef>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Read only memory mapping of a whole file. The mapping is released when the
+ * object goes out of scope.
+ */
+class PSFMappedFile {
+public:
+    PSFMappedFile(): ptr(nullptr), len(0) {}
+    ~PSFMappedFile() { close(); }
+
+    PSFMappedFile(const PSFMappedFile&) = delete;
+    PSFMappedFile& operator=(const PSFMappedFile&) = delete;
+
+    /* open()
+     *
+     * maps the file <filename>. An empty file is mapped as a zero sized
+     * region.
+     *
+     * Returns:
+     *	true on success, false on failure.
+     */
+    bool open(const char *filename) {
+        close();
+
+        int fd = ::open(filename, O_RDONLY);
+        if (fd < 0) {
+            perror(__func__);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0) {
+            perror(__func__);
+            ::close(fd);
+            return false;
+        }
+        if (st.st_size > 0) {
+            void *p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                perror(__func__);
+                ::close(fd);
+                return false;
+            }
+            ptr = static_cast<const unsigned char *>(p);
+            len = static_cast<size_t>(st.st_size);
+            madvise(const_cast<unsigned char *>(ptr), len, MADV_WILLNEED);
+        }
+        ::close(fd);
+        return true;
+    }
+
+    void close() {
+        if (ptr != nullptr) {
+            munmap(const_cast<unsigned char *>(ptr), len);
+        }
+        ptr = nullptr;
+        len = 0;
+    }
+
+    const unsigned char *data() const { return ptr; }
+    size_t size() const { return len; }
+
+private:
+    const unsigned char *ptr;
+    size_t len;
+};
+
+#endif // PSFMMAP_H
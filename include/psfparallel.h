@@ -0,0 +1,67 @@
+#ifndef PSFPARALLEL_H
+#define PSFPARALLEL_H
+
+#include <cstddef>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace PSF {
+
+/* chunkCount()
+ *
+ * returns the number of chunks parallelChunks() will split <count> items
+ * into. There is at most one chunk per hardware thread and every chunk holds
+ * at least <minChunk> items, so small inputs are handled by a single chunk
+ * on the calling thread.
+ */
+inline unsigned chunkCount(size_t count, size_t minChunk)
+{
+    if (count == 0) {
+        return 0;
+    }
+    size_t hw = std::max(1u, std::thread::hardware_concurrency());
+    size_t byMin = (count + std::max<size_t>(minChunk, 1) - 1) / std::max<size_t>(minChunk, 1);
+    return static_cast<unsigned>(std::min(hw, byMin));
+}
+
+/* parallelChunks()
+ *
+ * splits the range [0, count) into chunkCount(count, minChunk) contiguous
+ * chunks and calls fn(chunk, begin, end) for each of them. The first chunk
+ * runs on the calling thread, the rest on their own threads. Returns once
+ * every chunk has finished.
+ */
+template <typename Fn>
+void parallelChunks(size_t count, size_t minChunk, Fn fn)
+{
+    unsigned nchunks = chunkCount(count, minChunk);
+    if (nchunks == 0) {
+        return;
+    }
+    if (nchunks == 1) {
+        fn(0u, size_t(0), count);
+        return;
+    }
+
+    size_t per = count / nchunks, extra = count % nchunks;
+    std::vector<std::thread> workers;
+    workers.reserve(nchunks - 1);
+
+    size_t first_end = per + (extra > 0 ? 1 : 0);
+    size_t begin = first_end;
+    for (unsigned c = 1; c < nchunks; ++c) {
+        size_t end = begin + per + (c < extra ? 1 : 0);
+        workers.emplace_back(fn, c, begin, end);
+        begin = end;
+    }
+    fn(0u, size_t(0), first_end);
+
+    for (auto& t : workers) {
+        t.join();
+    }
+}
+
+}
+
+#endif // PSFPARALLEL_H
@@ -0,0 +1,37 @@
+#ifndef PSFPROGRESS_H
+#define PSFPROGRESS_H
+
+#include <atomic>
+#include <cstddef>
+
+/*
+ * Progress and cancellation state shared between a font loader running on
+ * a worker thread and whoever is watching it. Loaders call setTotal() and
+ * advance() as they go and stop as soon as isCanceled() returns true. All
+ * the methods are thread safe.
+ */
+class PSFProgress {
+public:
+    PSFProgress(): done(0), total(0), canceled(false) {}
+
+    void reset() {
+        done = 0;
+        total = 0;
+        canceled = false;
+    }
+
+    void setTotal(size_t n) { total = n; }
+    void advance(size_t n = 1) { done.fetch_add(n, std::memory_order_relaxed); }
+    size_t getDone() const { return done.load(std::memory_order_relaxed); }
+    size_t getTotal() const { return total.load(std::memory_order_relaxed); }
+
+    void cancel() { canceled = true; }
+    bool isCanceled() const { return canceled.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<size_t> done;
+    std::atomic<size_t> total;
+    std::atomic<bool> canceled;
+};
+
+#endif // PSFPROGRESS_H
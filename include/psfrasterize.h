@@ -0,0 +1,53 @@
+#ifndef PSFRASTERIZE_H
+#define PSFRASTERIZE_H
+
+#include <vector>
+#include <QFont>
+#include <QString>
+#include "psf.h"
+#include "psfprogress.h"
+
+struct PSFRasterOptions {
+    unsigned width = 8;         // glyph cell size
+    unsigned height = 16;
+    int pixelSize = 16;         // font size in pixels
+    int baseline = -1;          // baseline row, -1: the font ascent
+    bool antialias = false;     // render antialiased and threshold the result
+    bool hinting = true;        // full hinting, none otherwise
+    int threshold = 128;        // grey levels below it become set pixels
+    bool skipMissing = true;    // leave out code points the font has no glyph for
+};
+
+namespace PSF {
+    /* parseCodepointRanges()
+     *
+     * parses a list of code points and ranges separated by commas or
+     * whitespace, e.g. "0x20-0x7E, U+00A0-U+00FF 9472". Values are hex with
+     * a "U+" or "0x" prefix, decimal otherwise (see PSF::parseCodepoint()).
+     * <codepoints> gets them sorted and without duplicates, surrogates
+     * inside ranges are left out.
+     *
+     * Returns:
+     *	true on success, false on a malformed entry, a surrogate or a value
+     *	above 0x10FFFF.
+     */
+    bool parseCodepointRanges(const QString& text, std::vector<unsigned>& codepoints);
+
+    /* rasterizeFont()
+     *
+     * renders <codepoints> with <qfont> into a new PSF2 font, one glyph per
+     * code point, with the code point in the unicode table. Glyphs are
+     * drawn in parallel, every worker with its own QImage and QPainter.
+     * Where QFontDatabase::supportsThreadedFontRendering() is false they
+     * are drawn on the calling thread only, which must then be the GUI
+     * thread. <progress> (optional) counts the code points rendered.
+     *
+     * Returns:
+     *	the number of glyphs, or -1 if rendering was canceled or nothing was
+     *	rendered.
+     */
+    int rasterizeFont(PSFFont& font, const QFont& qfont, const std::vector<unsigned>& codepoints,
+                      const PSFRasterOptions& opt, PSFProgress *progress = nullptr);
+}
+
+#endif // PSFRASTERIZE_H
@@ -0,0 +1,75 @@
+#ifndef PSFRESIZE_H
+#define PSFRESIZE_H
+
+#include "psf.h"
+
+/*
+ * How rescaleFont() maps source pixels to target pixels.
+ */
+enum class PSFScaleMode {
+    Nearest, // integer factors, every pixel becomes a block
+    Scale2x, // exactly twice the size, smooths diagonal edges
+    Scale3x, // exactly three times the size, smooths diagonal edges
+    Box      // any smaller size, a pixel is set if enough of its box is
+};
+
+/*
+ * Smallest rectangle holding every set pixel of a font.
+ */
+struct PSFBoundingBox {
+    unsigned left = 0;
+    unsigned top = 0;
+    unsigned width = 0;
+    unsigned height = 0;
+
+    bool isEmpty() const { return width == 0 || height == 0; }
+};
+
+namespace PSF {
+    /* rescaleFont()
+     *
+     * builds <dst>, a copy of <src> with <width> x <height> glyphs scaled
+     * with <mode>. Glyphs are scaled in parallel and keep their unicode
+     * values. The result is a PSF1 font if <src> is one and the new size
+     * still fits PSF1, a PSF2 font otherwise.
+     *
+     * Arguments:
+     *	coverage	(Box only) percentage of set pixels in a box needed to
+     *			set the target pixel, 1 to 100
+     *
+     * Returns:
+     *	true on success, false if the size does not suit <mode>: Nearest
+     *	needs whole factors (up to 8 horizontally), Scale2x and Scale3x
+     *	exactly 2 and 3 times the size, Box a size not bigger than <src>.
+     */
+    bool rescaleFont(const PSFFont& src, PSFFont& dst, unsigned width, unsigned height,
+                     PSFScaleMode mode, unsigned coverage = 50);
+
+    /* fontBoundingBox()
+     *
+     * computes the union of the bounding boxes of every glyph, ORing the
+     * rows of the glyphs together in parallel.
+     *
+     * Returns:
+     *	the bounding box, empty if no glyph has a set pixel.
+     */
+    PSFBoundingBox fontBoundingBox(const PSFFont& font);
+
+    /* relayoutFont()
+     *
+     * builds <dst>, a copy of <src> with <width> x <height> glyphs where
+     * every pixel moves <shiftX> pixels right and <shiftY> pixels down.
+     * Pixels that fall outside the new glyph are dropped, new space is
+     * left empty. Glyphs are re-packed in parallel with whole row shifts.
+     * To crop a font to its bounding box <bb>:
+     *
+     *	relayoutFont(src, dst, bb.width, bb.height, -bb.left, -bb.top);
+     *
+     * Returns:
+     *	true on success, false if the new size is empty.
+     */
+    bool relayoutFont(const PSFFont& src, PSFFont& dst, unsigned width, unsigned height,
+                      int shiftX, int shiftY);
+}
+
+#endif // PSFRESIZE_H
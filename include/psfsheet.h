@@ -0,0 +1,70 @@
+#ifndef PSFSHEET_H
+#define PSFSHEET_H
+
+#include <vector>
+#include <QImage>
+#include <QString>
+#include "psf.h"
+
+/*
+ * Geometry of a sprite sheet: a grid of glyph cells, optionally with a
+ * margin around the grid and spacing between the cells.
+ */
+struct PSFSheetLayout {
+    unsigned cellWidth = 8;
+    unsigned cellHeight = 16;
+    unsigned columns = 0;       // 0: as many as fit in the sheet width
+    unsigned marginX = 0;       // left and top margin of the grid
+    unsigned marginY = 0;
+    unsigned spacingX = 0;      // gap between adjacent cells
+    unsigned spacingY = 0;
+    unsigned startIndex = 0;    // glyph the first cell goes to
+    unsigned count = 0;         // 0: every cell in the sheet
+    int threshold = 128;        // grey levels below it become set pixels
+};
+
+namespace PSF {
+    /* loadFromSpriteSheet()
+     *
+     * slices the sprite sheet <sheet> into glyphs following <layout>. Cells
+     * are decoded in parallel and stored into glyphs startIndex, startIndex
+     * + 1, ... The font grows as needed. Cells bigger than the font are
+     * cropped, smaller ones leave the rest of the glyph empty. If
+     * <codepoints> is not empty, the n-th cell gets codepoints[n] as its
+     * only unicode value. A cell with a value above 0x10FFFF (a "-" in the
+     * code point list) is left without unicode values, cells past the end
+     * of the list keep theirs.
+     *
+     * Returns:
+     *	the number of glyphs imported, -1 if the layout does not fit in the
+     *	sheet, -2 if a PSF1 font cannot hold the glyphs (more than 512), or
+     *	-3 if a PSF1 font cannot hold a code point (above 0xFFFF).
+     */
+    int loadFromSpriteSheet(PSFFont& font, const QImage& sheet, const PSFSheetLayout& layout,
+                            const std::vector<unsigned>& codepoints);
+
+    /* readCodepointList()
+     *
+     * reads a code point order file: whitespace separated code points, in
+     * hex with a "U+" or "0x" prefix or in decimal (see
+     * PSF::parseCodepoint()). "-" leaves a cell without code point.
+     *
+     * Returns:
+     *	true on success, false if the file cannot be read or holds a
+     *	malformed entry, a surrogate or a value above 0x10FFFF.
+     */
+    bool readCodepointList(const QString& filename, std::vector<unsigned>& codepoints);
+
+    /* saveToSpriteSheet()
+     *
+     * saves the font as a 1 bit PNG atlas with <columns> glyphs per row,
+     * plus a JSON file (<pngFile> with a .json suffix) describing the grid
+     * and the unicode values of every glyph.
+     *
+     * Returns:
+     *	true on success, false on failure.
+     */
+    bool saveToSpriteSheet(const PSFFont& font, const QString& pngFile, unsigned columns);
+}
+
+#endif // PSFSHEET_H
@@ -4,13 +4,19 @@
 #include <cstdint>
 #include <vector>
 #include <QString>
+#include <QStringList>
+#include <QRegularExpression>
 #include <QImage>
 #include <QMetaType>
 #include "psf.h"
+#include "psfprogress.h"
 
 enum class FileType {
     MIF, // Verilog MIF
-    PSF  // PSF File
+    PSF, // PSF File
+    BDF, // BDF File
+    HEX, // GNU Unifont .hex File
+    PSFC // Compiled font blob
 };
 
 namespace PSF {
@@ -22,7 +28,18 @@ namespace PSF {
 
     // Verilog MIF utilities
     bool saveToVerilogMif(const PSFFont& font, const std::string& filename);
-    bool loadFromVerilogMif(PSFFont& font, unsigned gw, unsigned gh, const std::string& filename);
+    bool loadFromVerilogMif(PSFFont& font, unsigned gw, unsigned gh, const std::string& filename,
+                            PSFProgress *progress = nullptr);
+
+    // Loads a PSF, PSFC, BDF or HEX font, picking the format by file extension
+    bool loadFontFile(PSFFont& font, const std::string& filename);
+
+    // Code point lists
+    // Splits <text> at <separators>, dropping empty tokens
+    QStringList splitTokens(const QString& text, const QRegularExpression& separators);
+    // Parses a code point, hex with a "U+" or "0x" prefix or decimal. Fails
+    // for surrogates and values above 0x10FFFF.
+    bool parseCodepoint(const QString& tok, unsigned& cp);
 }
 
 Q_DECLARE_METATYPE(PSFGlyph*)
@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <list>
 #include <QWidget>
+#include <QImage>
+#include <QVector>
 #include <QMouseEvent>
 #include "psf.h"
 
@@ -62,7 +64,7 @@ public:
     void setCurrGlyphIndex(int idx) {
         glyph_index = idx;
         updateCanvasInfo();
-        repaint();
+        update();
     }
 
     PSFFont *getFont() { return font; }
@@ -78,9 +80,11 @@ public:
 
 private:
     void updateCanvasInfo();
-    void drawGlyph(QPainter &painter);
+    void rebuildRaster();
+    void drawDot(QPainter &painter, int gx, int gy, bool set);
+    QRect dotRect(int gx, int gy);
     bool findPointInCanvas(const QPoint& pt, QPoint &cpt);
-    void flipGlyphPoint(const QPoint& gpt);
+    void flipGlyphPoints(const QVector<QPoint>& gpts);
 
 protected:
     void paintEvent(QPaintEvent *e);
@@ -91,7 +95,7 @@ protected:
     void wheelEvent(QWheelEvent *e);
 
 signals:
-    void glyphChanged();
+    void glyphChanged(int index);
 
 public slots:
 private:
@@ -103,6 +107,12 @@ private:
     bool glyph_edited;
     PSFFont *font;
     int glyph_index;
+
+    // Cached rendering of the grid and dots, in canvas coordinates
+    QImage raster;
+    bool raster_valid;
+    int raster_glyph;
+    unsigned long raster_generation;
 };
 
 #endif // QFONTGLYPHEDITOR_H
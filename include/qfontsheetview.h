@@ -0,0 +1,52 @@
+#ifndef QFONTSHEETVIEW_H
+#define QFONTSHEETVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QMouseEvent>
+#include "fontatlas.h"
+
+#define DEFAULT_SHEET_ZOOM 2
+#define MIN_SHEET_ZOOM 1
+#define MAX_SHEET_ZOOM 16
+
+/*
+ * Zoomable overview of the whole font. The glyphs are kept in a FontAtlas
+ * and every paint event only scales the visible part of the atlas.
+ */
+class QFontSheetView : public QAbstractScrollArea
+{
+    Q_OBJECT
+public:
+    explicit QFontSheetView(QWidget *parent = nullptr);
+
+    void setFont(PSFFont *font);
+    void setCurrentGlyph(int index);
+
+    /*
+     * Refreshes the tile of glyph <index> if it changed.
+     */
+    void updateGlyph(int index);
+
+    void setZoom(int z);
+    int getZoom() const { return zoom; }
+
+signals:
+    void glyphClicked(int index);
+
+protected:
+    void paintEvent(QPaintEvent *e) override;
+    void resizeEvent(QResizeEvent *e) override;
+    void mousePressEvent(QMouseEvent *e) override;
+    void wheelEvent(QWheelEvent *e) override;
+
+private:
+    void updateScrollBars();
+    QRect viewRectOfTile(int index) const;
+
+private:
+    FontAtlas atlas;
+    int zoom;
+    int current_glyph;
+};
+
+#endif // QFONTSHEETVIEW_H
@@ -0,0 +1,35 @@
+#ifndef QGLYPHDIFFVIEW_H
+#define QGLYPHDIFFVIEW_H
+
+#include <vector>
+#include <QWidget>
+#include "psf.h"
+
+/*
+ * Shows two versions of a glyph side by side. Pixels that differ are
+ * drawn in red (set) or pink (unset).
+ */
+class QGlyphDiffView : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit QGlyphDiffView(QWidget *parent = nullptr);
+
+    /*
+     * Shows glyphs <a> and <b> of a <width> x <height> font. Either of them
+     * can be null for a glyph that only exists in one of the fonts.
+     */
+    void setGlyphs(const PSFGlyph *a, const PSFGlyph *b, unsigned width, unsigned height);
+
+protected:
+    void paintEvent(QPaintEvent *e) override;
+
+private:
+    void drawPanel(QPainter &painter, const QRect &r, const std::vector<unsigned char> &bits, int dot);
+
+private:
+    std::vector<unsigned char> bitsA, bitsB, mask;
+    unsigned gw, gh;
+};
+
+#endif // QGLYPHDIFFVIEW_H
@@ -0,0 +1,41 @@
+#ifndef QGLYPHLISTMODEL_H
+#define QGLYPHLISTMODEL_H
+
+#include <QAbstractListModel>
+#include "psf.h"
+
+/*
+ * List model exposing the glyphs of a PSFFont. Rows are produced on demand
+ * from the font, so views only materialize the visible ones.
+ *
+ * Roles:
+ *	Qt::DisplayRole	the glyph index as text
+ *	Qt::UserRole	a PSFGlyph pointer to the glyph
+ */
+class QGlyphListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit QGlyphListModel(QObject *parent = nullptr);
+
+    /*
+     * Sets the font shown by the model. Views are reset, so this must be
+     * called again whenever the glyph vector of the font is rebuilt.
+     */
+    void setFont(PSFFont *_font);
+    PSFFont *getFont() const { return font; }
+
+    /*
+     * Tells attached views that the glyph at <glyphIndex> changed.
+     */
+    void glyphChanged(int glyphIndex);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private:
+    PSFFont *font;
+};
+
+#endif // QGLYPHLISTMODEL_H
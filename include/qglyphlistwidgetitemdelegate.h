@@ -2,19 +2,44 @@
 #define QGLYPHLISTWIDGETITEMDELEGATE_H
 
 #include <QPair>
+#include <QBitmap>
+#include <QCache>
 #include <QStyledItemDelegate>
+#include "psf.h"
+
+/*
+ * Memory budget (in bytes) of the glyph thumbnail cache
+ */
+#define THUMBNAIL_CACHE_BYTES (8 * 1024 * 1024)
 
 class QGlyphListWidgetItemDelegate : public QStyledItemDelegate
 {
     Q_OBJECT
 
 public:
-    QGlyphListWidgetItemDelegate(QWidget *parent = nullptr) : QStyledItemDelegate(parent) {}
+    QGlyphListWidgetItemDelegate(QWidget *parent = nullptr);
+
+    /*
+     * Sets the font whose glyphs are drawn. Drops every cached thumbnail.
+     */
+    void setFont(PSFFont *_font);
 
     void paint(QPainter *painter, const QStyleOptionViewItem &option,
                const QModelIndex &index) const override;
     QSize sizeHint(const QStyleOptionViewItem &option,
                        const QModelIndex &index) const override;
+
+private:
+    struct Thumbnail {
+        unsigned long generation;
+        QBitmap bitmap;
+    };
+
+    const QBitmap &thumbnail(int index, const PSFGlyph &glyph) const;
+
+private:
+    PSFFont *font;
+    mutable QCache<int, Thumbnail> cache;
 };
 
 #endif // QGLYPHLISTWIDGETITEMDELEGATE_H
@@ -0,0 +1,78 @@
+#ifndef QSAMPLETEXTVIEW_H
+#define QSAMPLETEXTVIEW_H
+
+#include <unordered_map>
+#include <vector>
+#include <QAbstractScrollArea>
+#include <QImage>
+#include <QString>
+#include "psf.h"
+
+#define DEFAULT_SAMPLE_ZOOM 2
+
+/*
+ * Sample text shown in the preview until the user types their own
+ */
+#define DEFAULT_SAMPLE_TEXT "The quick brown fox jumps over the lazy dog.\n" \
+                            "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG!\n" \
+                            "0123456789 ()[]{}<>+-*/=%&|^~ #$@ \"'`,.:;?_\\"
+
+/*
+ * Live preview of a multi line sample text set in the font being edited.
+ * Characters are mapped to glyphs through the unicode table and the text is
+ * rendered once into a monochrome image at 1x, which paint events scale.
+ * The cells are indexed by glyph, so when a glyph changes only the cells
+ * showing it are blitted again.
+ */
+class QSampleTextView : public QAbstractScrollArea
+{
+    Q_OBJECT
+public:
+    explicit QSampleTextView(QWidget *parent = nullptr);
+
+    void setFont(PSFFont *font);
+    void setText(const QString &text);
+    const QString &text() const { return sampleText; }
+
+    /*
+     * Maps the text to glyphs again, for when unicode values changed
+     * without the font being set again.
+     */
+    void refreshMapping();
+
+    /*
+     * Blits again the cells showing glyph <index>.
+     */
+    void updateGlyph(int index);
+
+    void setZoom(int z);
+    int getZoom() const { return zoom; }
+
+protected:
+    void paintEvent(QPaintEvent *e) override;
+    void resizeEvent(QResizeEvent *e) override;
+
+private:
+    struct Cell {
+        int glyph;
+        int column;
+        int line;
+    };
+
+    void layoutText();
+    void renderCell(const Cell &cell);
+    void updateScrollBars();
+    int glyphFor(unsigned codepoint) const;
+    QRect viewRectOfCell(const Cell &cell) const;
+
+private:
+    PSFFont *font;
+    QString sampleText;
+    int zoom;
+    QImage img;
+    std::unordered_map<unsigned, int> glyphOf; // first glyph of every code point
+    int fallbackGlyph;                         // shown for unmapped characters, or -1
+    std::vector<Cell> cells;                   // non empty cells, sorted by glyph
+};
+
+#endif // QSAMPLETEXTVIEW_H
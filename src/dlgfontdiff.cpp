@@ -0,0 +1,46 @@
+#include "dlgfontdiff.h"
+#include "ui_dlgfontdiff.h"
+
+DlgFontDiff::DlgFontDiff(QWidget *parent, const PSFFont &a, const PSFFont &b, const PSFFontDiff &diff,
+                         const QString &nameA, const QString &nameB) :
+    QDialog(parent),
+    ui(new Ui::DlgFontDiff),
+    fontA(a),
+    fontB(b),
+    diff(diff)
+{
+    ui->setupUi(this);
+    ui->lblSummary->setText(tr("%1 vs %2: %3 changed, %4 added, %5 removed, %6 with different unicode values, %7 pixels")
+                            .arg(nameA, nameB)
+                            .arg(diff.changed).arg(diff.added).arg(diff.removed)
+                            .arg(diff.unicodeChanged).arg(diff.pixels));
+
+    for (const PSFGlyphDiff &g : diff.glyphs) {
+        QString kind = (g.kind == PSFDiffKind::Added) ? tr("added")
+                     : (g.kind == PSFDiffKind::Removed) ? tr("removed") : tr("changed");
+        QString text = tr("%1: %2, %3 pixels").arg(g.index).arg(kind).arg(g.pixels);
+        if (g.unicodeChanged) {
+            text += tr(", unicode");
+        }
+        ui->lstGlyphs->addItem(text);
+    }
+    if (!diff.glyphs.empty()) {
+        ui->lstGlyphs->setCurrentRow(0);
+    }
+}
+
+DlgFontDiff::~DlgFontDiff()
+{
+    delete ui;
+}
+
+void DlgFontDiff::on_lstGlyphs_currentRowChanged(int row)
+{
+    if (row < 0 || static_cast<size_t>(row) >= diff.glyphs.size()) {
+        return;
+    }
+    unsigned index = diff.glyphs[static_cast<size_t>(row)].index;
+    const PSFGlyph *a = (index < fontA.getNumGlyphs()) ? &fontA.getGlyph(index) : nullptr;
+    const PSFGlyph *b = (index < fontB.getNumGlyphs()) ? &fontB.getGlyph(index) : nullptr;
+    ui->diffView->setGlyphs(a, b, fontA.getWidth(), fontA.getHeight());
+}
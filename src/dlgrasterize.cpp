@@ -0,0 +1,45 @@
+#include "dlgrasterize.h"
+#include "ui_dlgrasterize.h"
+
+DlgRasterize::DlgRasterize(QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::DlgRasterize)
+{
+    ui->setupUi(this);
+    ui->cmbFont->setFontFilters(QFontComboBox::MonospacedFonts);
+    on_chkAntialias_toggled(ui->chkAntialias->isChecked());
+}
+
+DlgRasterize::~DlgRasterize()
+{
+    delete ui;
+}
+
+QFont DlgRasterize::getFont() const
+{
+    return ui->cmbFont->currentFont();
+}
+
+PSFRasterOptions DlgRasterize::getOptions() const
+{
+    PSFRasterOptions opt;
+    opt.width = static_cast<unsigned>(ui->edtWidth->value());
+    opt.height = static_cast<unsigned>(ui->edtHeight->value());
+    opt.pixelSize = ui->edtPixelSize->value();
+    opt.baseline = ui->edtBaseline->value();
+    opt.antialias = ui->chkAntialias->isChecked();
+    opt.hinting = ui->chkHinting->isChecked();
+    opt.threshold = ui->edtThreshold->value();
+    opt.skipMissing = ui->chkSkipMissing->isChecked();
+    return opt;
+}
+
+QString DlgRasterize::getRanges() const
+{
+    return ui->edtRanges->text();
+}
+
+void DlgRasterize::on_chkAntialias_toggled(bool checked)
+{
+    ui->edtThreshold->setEnabled(checked);
+}
@@ -0,0 +1,72 @@
+#include "dlgrelayout.h"
+#include "ui_dlgrelayout.h"
+
+DlgRelayout::DlgRelayout(QWidget *parent, const PSFFont &font, const PSFBoundingBox &bb) :
+    QDialog(parent),
+    ui(new Ui::DlgRelayout),
+    bbox(bb),
+    numGlyphs(font.getNumGlyphs()),
+    glyphSize(font.getGlyphSize())
+{
+    ui->setupUi(this);
+    ui->edtWidth->setValue(static_cast<int>(font.getWidth()));
+    ui->edtHeight->setValue(static_cast<int>(font.getHeight()));
+
+    if (bb.isEmpty()) {
+        ui->lblBoundingBox->setText(tr("Current size %1x%2, every glyph is empty")
+                                    .arg(font.getWidth()).arg(font.getHeight()));
+        ui->btnAutoCrop->setEnabled(false);
+    } else {
+        ui->lblBoundingBox->setText(tr("Current size %1x%2, glyphs use %3x%4 pixels at (%5, %6)")
+                                    .arg(font.getWidth()).arg(font.getHeight())
+                                    .arg(bb.width).arg(bb.height).arg(bb.left).arg(bb.top));
+    }
+
+    connect(ui->edtWidth, QOverload<int>::of(&QSpinBox::valueChanged), this, &DlgRelayout::updateMemory);
+    connect(ui->edtHeight, QOverload<int>::of(&QSpinBox::valueChanged), this, &DlgRelayout::updateMemory);
+    updateMemory();
+}
+
+DlgRelayout::~DlgRelayout()
+{
+    delete ui;
+}
+
+unsigned DlgRelayout::getWidth() const
+{
+    return static_cast<unsigned>(ui->edtWidth->value());
+}
+
+unsigned DlgRelayout::getHeight() const
+{
+    return static_cast<unsigned>(ui->edtHeight->value());
+}
+
+int DlgRelayout::getShiftX() const
+{
+    return ui->edtShiftX->value();
+}
+
+int DlgRelayout::getShiftY() const
+{
+    return ui->edtShiftY->value();
+}
+
+void DlgRelayout::on_btnAutoCrop_clicked()
+{
+    ui->edtWidth->setValue(static_cast<int>(bbox.width));
+    ui->edtHeight->setValue(static_cast<int>(bbox.height));
+    ui->edtShiftX->setValue(-static_cast<int>(bbox.left));
+    ui->edtShiftY->setValue(-static_cast<int>(bbox.top));
+}
+
+void DlgRelayout::updateMemory()
+{
+    qint64 oldBytes = static_cast<qint64>(glyphSize) * numGlyphs;
+    qint64 newBytes = static_cast<qint64>((getWidth() + 7) >> 3) * getHeight() * numGlyphs;
+    QString text = tr("Glyph data: %1 bytes, %2 bytes after resizing").arg(oldBytes).arg(newBytes);
+    if (newBytes < oldBytes) {
+        text += tr(" (%1 bytes saved)").arg(oldBytes - newBytes);
+    }
+    ui->lblMemory->setText(text);
+}
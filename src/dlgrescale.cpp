@@ -0,0 +1,61 @@
+#include "dlgrescale.h"
+#include "ui_dlgrescale.h"
+
+DlgRescale::DlgRescale(QWidget *parent, unsigned width, unsigned height) :
+    QDialog(parent),
+    ui(new Ui::DlgRescale),
+    srcWidth(width),
+    srcHeight(height)
+{
+    ui->setupUi(this);
+    on_cmbMode_currentIndexChanged(ui->cmbMode->currentIndex());
+}
+
+DlgRescale::~DlgRescale()
+{
+    delete ui;
+}
+
+PSFScaleMode DlgRescale::getMode() const
+{
+    return static_cast<PSFScaleMode>(ui->cmbMode->currentIndex());
+}
+
+unsigned DlgRescale::getWidth() const
+{
+    return static_cast<unsigned>(ui->edtWidth->value());
+}
+
+unsigned DlgRescale::getHeight() const
+{
+    return static_cast<unsigned>(ui->edtHeight->value());
+}
+
+unsigned DlgRescale::getCoverage() const
+{
+    return static_cast<unsigned>(ui->edtCoverage->value());
+}
+
+/*
+ * Suggests the usual target size of each algorithm: twice or three times
+ * the size when scaling up, half the size when downsampling.
+ */
+void DlgRescale::on_cmbMode_currentIndexChanged(int index)
+{
+    PSFScaleMode mode = static_cast<PSFScaleMode>(index);
+    unsigned w = srcWidth * 2, h = srcHeight * 2;
+    if (mode == PSFScaleMode::Scale3x) {
+        w = srcWidth * 3;
+        h = srcHeight * 3;
+    } else if (mode == PSFScaleMode::Box) {
+        w = qMax(1u, srcWidth / 2);
+        h = qMax(1u, srcHeight / 2);
+    }
+    ui->edtWidth->setValue(static_cast<int>(w));
+    ui->edtHeight->setValue(static_cast<int>(h));
+
+    bool fixed = (mode == PSFScaleMode::Scale2x || mode == PSFScaleMode::Scale3x);
+    ui->edtWidth->setEnabled(!fixed);
+    ui->edtHeight->setEnabled(!fixed);
+    ui->edtCoverage->setEnabled(mode == PSFScaleMode::Box);
+}
@@ -0,0 +1,47 @@
+#include <QFileDialog>
+#include "dlgspritesheet.h"
+#include "ui_dlgspritesheet.h"
+
+DlgSpriteSheet::DlgSpriteSheet(QWidget *parent, unsigned cellWidth, unsigned cellHeight) :
+    QDialog(parent),
+    ui(new Ui::DlgSpriteSheet)
+{
+    ui->setupUi(this);
+    ui->edtCellWidth->setValue(static_cast<int>(cellWidth));
+    ui->edtCellHeight->setValue(static_cast<int>(cellHeight));
+}
+
+DlgSpriteSheet::~DlgSpriteSheet()
+{
+    delete ui;
+}
+
+PSFSheetLayout DlgSpriteSheet::getLayout() const
+{
+    PSFSheetLayout layout;
+    layout.cellWidth = static_cast<unsigned>(ui->edtCellWidth->value());
+    layout.cellHeight = static_cast<unsigned>(ui->edtCellHeight->value());
+    layout.columns = static_cast<unsigned>(ui->edtColumns->value());
+    layout.marginX = static_cast<unsigned>(ui->edtMarginX->value());
+    layout.marginY = static_cast<unsigned>(ui->edtMarginY->value());
+    layout.spacingX = static_cast<unsigned>(ui->edtSpacingX->value());
+    layout.spacingY = static_cast<unsigned>(ui->edtSpacingY->value());
+    layout.startIndex = static_cast<unsigned>(ui->edtStartIndex->value());
+    layout.count = static_cast<unsigned>(ui->edtCount->value());
+    layout.threshold = ui->edtThreshold->value();
+    return layout;
+}
+
+QString DlgSpriteSheet::getCodepointFile() const
+{
+    return ui->edtCodepointFile->text();
+}
+
+void DlgSpriteSheet::on_btnBrowse_clicked()
+{
+    QString filePath = QFileDialog::getOpenFileName(this, tr("Code point order file"), QString(),
+                                                    tr("Text files (*.txt);;All Files (*)"));
+    if (!filePath.isEmpty()) {
+        ui->edtCodepointFile->setText(filePath);
+    }
+}
@@ -0,0 +1,85 @@
+#include <cstring>
+#include "fontatlas.h"
+
+FontAtlas::FontAtlas() :
+    font(nullptr),
+    cols(DEFAULT_ATLAS_COLUMNS),
+    rowCount(0),
+    tileW(0),
+    tileH(0),
+    padMask(0xFF)
+{ }
+
+void FontAtlas::setFont(PSFFont *_font, int _columns)
+{
+    font = _font;
+    cols = qMax(1, _columns);
+    generations.clear();
+    img = QImage();
+    if (font == nullptr || font->getNumGlyphs() == 0) {
+        rowCount = 0;
+        return;
+    }
+
+    int count = static_cast<int>(font->getNumGlyphs());
+    tileW = static_cast<int>((font->getWidth() + 7) & ~7u);
+    tileH = static_cast<int>(font->getHeight());
+    padMask = static_cast<uchar>(0xFF << (tileW - static_cast<int>(font->getWidth())));
+    rowCount = (count + cols - 1) / cols;
+
+    img = QImage(cols * tileW, rowCount * tileH, QImage::Format_Mono);
+    img.setColor(0, qRgb(0, 43, 54));
+    img.setColor(1, qRgb(255, 140, 0));
+    img.fill(0);
+
+    generations.resize(static_cast<size_t>(count));
+    for (int i = 0; i < count; i++) {
+        renderGlyph(i);
+    }
+}
+
+bool FontAtlas::updateGlyph(int index)
+{
+    if (isNull() || index < 0 || index >= glyphCount()) {
+        return false;
+    }
+    if (generations[static_cast<size_t>(index)] == font->getGlyph(static_cast<unsigned>(index)).getGeneration()) {
+        return false;
+    }
+    renderGlyph(index);
+    return true;
+}
+
+QRect FontAtlas::tileRect(int index) const
+{
+    return QRect((index % cols) * tileW, (index / cols) * tileH, tileW, tileH);
+}
+
+int FontAtlas::glyphAt(const QPoint &pt) const
+{
+    if (isNull() || pt.x() < 0 || pt.y() < 0 || pt.x() >= img.width()) {
+        return -1;
+    }
+    int index = (pt.y() / tileH) * cols + (pt.x() / tileW);
+    return (index < glyphCount()) ? index : -1;
+}
+
+void FontAtlas::renderGlyph(int index)
+{
+    const PSFGlyph &glyph = font->getGlyph(static_cast<unsigned>(index));
+    const std::vector<unsigned char> &data = glyph.getData();
+    unsigned rowBytes = static_cast<unsigned>(tileW) >> 3;
+    int x0 = (index % cols) * static_cast<int>(rowBytes);
+    int y0 = (index / cols) * tileH;
+
+    for (int y = 0; y < tileH; y++) {
+        uchar *dst = img.scanLine(y0 + y) + x0;
+        if (data.empty()) {
+            memset(dst, 0, rowBytes);
+        } else {
+            memcpy(dst, &data[static_cast<unsigned>(y) * rowBytes], rowBytes);
+            dst[rowBytes - 1] &= padMask;
+        }
+    }
+    generations[static_cast<size_t>(index)] = glyph.getGeneration();
+}
@@ -0,0 +1,40 @@
+#include <algorithm>
+#include <QGuiApplication>
+#include <QScreen>
+#include "glyphchangebus.h"
+
+GlyphChangeBus::GlyphChangeBus(QObject *parent) :
+    QObject(parent)
+{
+    qreal rate = 60.0;
+    QScreen *screen = QGuiApplication::primaryScreen();
+    if (screen != nullptr && screen->refreshRate() > 1.0) {
+        rate = screen->refreshRate();
+    }
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+    timer.setInterval(qMax(1, static_cast<int>(1000.0 / rate)));
+    connect(&timer, &QTimer::timeout, this, &GlyphChangeBus::flush);
+}
+
+void GlyphChangeBus::notify(int index)
+{
+    pending.append(index);
+    if (!timer.isActive()) {
+        timer.start();
+    }
+}
+
+void GlyphChangeBus::flush()
+{
+    timer.stop();
+    if (pending.isEmpty()) {
+        return;
+    }
+    std::sort(pending.begin(), pending.end());
+    pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+
+    QVector<int> indices;
+    indices.swap(pending);
+    emit glyphsChanged(indices);
+}
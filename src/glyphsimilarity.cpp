@@ -0,0 +1,121 @@
+#include <cstring>
+#include <algorithm>
+#include <bitset>
+#include <climits>
+#include "glyphsimilarity.h"
+#include "psfparallel.h"
+
+namespace {
+
+// Minimum amount of glyphs packed or scanned by a worker
+const size_t SIMILARITY_MIN_CHUNK_GLYPHS = 8192;
+
+inline unsigned popCount(uint64_t v)
+{
+    return static_cast<unsigned>(std::bitset<64>(v).count());
+}
+
+// Heap order: the worst match (largest distance, then largest index) on top
+inline bool betterMatch(const GlyphMatch& a, const GlyphMatch& b)
+{
+    return (a.distance != b.distance) ? a.distance < b.distance : a.index < b.index;
+}
+
+}
+
+void GlyphSimilarityIndex::pack(const PSFGlyph& glyph, uint64_t *dst) const
+{
+    const std::vector<unsigned char>& data = glyph.getData();
+    memset(dst, 0, words * sizeof(uint64_t));
+    if (data.size() == glyphsize) {
+        memcpy(dst, data.data(), glyphsize);
+    }
+}
+
+void GlyphSimilarityIndex::build(const PSFFont& font)
+{
+    glyphsize = font.getGlyphSize();
+    words = (glyphsize + 7) / 8;
+    count = font.getNumGlyphs();
+    slab.assign(static_cast<size_t>(count) * words, 0);
+
+    PSF::parallelChunks(count, SIMILARITY_MIN_CHUNK_GLYPHS, [&](unsigned, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            pack(font.getGlyph(static_cast<unsigned>(i)), &slab[i * words]);
+        }
+    });
+}
+
+void GlyphSimilarityIndex::update(const PSFFont& font, unsigned index)
+{
+    if (font.getGlyphSize() != glyphsize) {
+        build(font);
+        return;
+    }
+    if (index >= font.getNumGlyphs()) {
+        return;
+    }
+    if (index >= count) {
+        count = font.getNumGlyphs();
+        slab.resize(static_cast<size_t>(count) * words, 0);
+    }
+    pack(font.getGlyph(index), &slab[static_cast<size_t>(index) * words]);
+}
+
+void GlyphSimilarityIndex::clear()
+{
+    slab.clear();
+    words = glyphsize = count = 0;
+}
+
+std::vector<GlyphMatch> GlyphSimilarityIndex::nearest(const unsigned char *bits, size_t k, int exclude) const
+{
+    std::vector<GlyphMatch> result;
+    if (k == 0 || count == 0) {
+        return result;
+    }
+    std::vector<uint64_t> query(words, 0);
+    memcpy(query.data(), bits, glyphsize);
+
+    unsigned nchunks = PSF::chunkCount(count, SIMILARITY_MIN_CHUNK_GLYPHS);
+    std::vector<std::vector<GlyphMatch>> best(nchunks);
+
+    PSF::parallelChunks(count, SIMILARITY_MIN_CHUNK_GLYPHS, [&](unsigned chunk, size_t begin, size_t end) {
+        std::vector<GlyphMatch>& heap = best[chunk];
+        heap.reserve(k);
+        unsigned limit = UINT_MAX;
+
+        for (size_t i = begin; i < end; ++i) {
+            if (static_cast<int>(i) == exclude) {
+                continue;
+            }
+            const uint64_t *g = &slab[i * words];
+            unsigned d = 0;
+            for (unsigned w = 0; w < words && d < limit; ++w) {
+                d += popCount(g[w] ^ query[w]);
+            }
+            // Glyphs are visited by index, so a tie never beats the heap top
+            if (d >= limit) {
+                continue;
+            }
+            if (heap.size() == k) {
+                std::pop_heap(heap.begin(), heap.end(), betterMatch);
+                heap.pop_back();
+            }
+            heap.push_back({static_cast<unsigned>(i), d});
+            std::push_heap(heap.begin(), heap.end(), betterMatch);
+            if (heap.size() == k) {
+                limit = heap.front().distance;
+            }
+        }
+    });
+
+    for (const std::vector<GlyphMatch>& chunk : best) {
+        result.insert(result.end(), chunk.begin(), chunk.end());
+    }
+    std::sort(result.begin(), result.end(), betterMatch);
+    if (result.size() > k) {
+        result.resize(k);
+    }
+    return result;
+}
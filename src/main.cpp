@@ -1,8 +1,148 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
 #include "mainwindow.h"
+#include "psfdiff.h"
+#include "psfconsole.h"
 #include <QApplication>
 
+/*
+ * --diff <font A> <font B>: prints the glyphs that differ between two fonts.
+ * Exits with 0 if the fonts are identical, 1 if they differ and 2 on error,
+ * so it can be used from scripts and CI.
+ */
+static int runDiff(const char *fileA, const char *fileB)
+{
+    PSFFont a, b;
+    if (!PSF::loadFontFile(a, fileA)) {
+        std::cerr << "Cannot load font '" << fileA << "'\n";
+        return 2;
+    }
+    if (!PSF::loadFontFile(b, fileB)) {
+        std::cerr << "Cannot load font '" << fileB << "'\n";
+        return 2;
+    }
+
+    PSFFontDiff diff;
+    auto start = std::chrono::steady_clock::now();
+    if (!PSF::diffFonts(a, b, diff)) {
+        std::cerr << "Glyph sizes differ: " << a.getWidth() << 'x' << a.getHeight()
+                  << " vs " << b.getWidth() << 'x' << b.getHeight() << '\n';
+        return 2;
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+    for (const PSFGlyphDiff& g : diff.glyphs) {
+        const char *kind = (g.kind == PSFDiffKind::Added) ? "added"
+                         : (g.kind == PSFDiffKind::Removed) ? "removed" : "changed";
+        std::cout << "glyph " << g.index << ": " << kind << ", " << g.pixels << " pixels"
+                  << (g.unicodeChanged ? ", unicode values" : "") << '\n';
+    }
+    std::cout << diff.changed << " changed, " << diff.added << " added, " << diff.removed << " removed, "
+              << diff.unicodeChanged << " with different unicode values, " << diff.pixels << " pixels ("
+              << elapsed.count() << " ms)\n";
+    return diff.identical() ? 0 : 1;
+}
+
+// Console size benchmarked by --bench-console, a 1920x1072 screen with 8x16 glyphs
+static const unsigned BENCH_COLUMNS = 240;
+static const unsigned BENCH_ROWS = 67;
+
+/*
+ * Fills row <y> of <con> with a line of text that changes with <line>.
+ */
+static void benchLine(PSFConsole &con, unsigned y, unsigned line)
+{
+    for (unsigned x = 0; x < con.columns(); ++x) {
+        uint32_t cp = ((line + x) % 8 == 7) ? ' ' : 0x21 + (line * 7 + x) % 94;
+        con.setCell(x, y, cp, static_cast<uint8_t>(1 + (x / 8 + line) % 15), 0);
+    }
+}
+
+/*
+ * --bench-console [font] [frames]: measures how many frames per second the
+ * console renderer draws for a 240x67 cell screen scrolling one line per
+ * frame, and for full redraws, to size the hardware of a framebuffer
+ * terminal. Without a font, an 8x16 font of random glyphs is used.
+ */
+static int runBenchConsole(const char *fontFile, unsigned frames)
+{
+    PSFFont font;
+    if (fontFile != nullptr) {
+        if (!PSF::loadFontFile(font, fontFile)) {
+            std::cerr << "Cannot load font '" << fontFile << "'\n";
+            return 2;
+        }
+    } else {
+        font.init(PSFVersion::V1, 8, 16);
+        srand(1);
+        for (unsigned i = 0; i < font.getNumGlyphs(); ++i) {
+            PSFGlyph &glyph = font.addGlyph(i);
+            for (unsigned y = 2; y < 14 && i != ' '; ++y) {
+                for (unsigned x = 1; x < 7; ++x) {
+                    glyph.setPixel(x, y, static_cast<unsigned>(rand() & 1));
+                }
+            }
+        }
+    }
+    if (font.getNumGlyphs() == 0) {
+        std::cerr << "The font has no glyphs\n";
+        return 2;
+    }
+
+    PSFConsole con(font, BENCH_COLUMNS, BENCH_ROWS);
+    size_t pitch = static_cast<size_t>(con.pixelWidth()) * sizeof(uint32_t);
+    std::vector<uint32_t> pixels(static_cast<size_t>(con.pixelWidth()) * con.pixelHeight());
+    for (unsigned y = 0; y < con.rows(); ++y) {
+        benchLine(con, y, y);
+    }
+    con.render(pixels.data(), pitch);
+
+    auto measure = [&](bool fullRedraw) {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned f = 0; f < frames; ++f) {
+            con.scrollUp(1, 0);
+            benchLine(con, con.rows() - 1, con.rows() + f);
+            if (fullRedraw) {
+                con.invalidate();
+            }
+            con.render(pixels.data(), pitch);
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    double scroll = measure(false);
+    double redraw = measure(true);
+
+    double mpixels = static_cast<double>(con.pixelWidth()) * con.pixelHeight() / 1e6;
+    std::cout << con.columns() << 'x' << con.rows() << " cells, " << con.pixelWidth() << 'x' << con.pixelHeight()
+              << " pixels, " << font.getWidth() << 'x' << font.getHeight() << " glyphs, " << frames << " frames\n";
+    std::cout << "scroll:      " << frames / scroll << " frames/s (" << scroll * 1000.0 / frames << " ms/frame)\n";
+    std::cout << "full redraw: " << frames / redraw << " frames/s (" << redraw * 1000.0 / frames << " ms/frame, "
+              << mpixels * frames / redraw << " Mpixels/s)\n";
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && strcmp(argv[1], "--diff") == 0) {
+        if (argc != 4) {
+            std::cerr << "Usage: " << argv[0] << " --diff <font A> <font B>\n";
+            return 2;
+        }
+        return runDiff(argv[2], argv[3]);
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-console") == 0) {
+        const char *fontFile = (argc > 2) ? argv[2] : nullptr;
+        int frames = (argc > 3) ? atoi(argv[3]) : 1000;
+        if (argc > 4 || frames <= 0) {
+            std::cerr << "Usage: " << argv[0] << " --bench-console [font] [frames]\n";
+            return 2;
+        }
+        return runBenchConsole(fontFile, static_cast<unsigned>(frames));
+    }
+
     QApplication a(argc, argv);
     QString filePath;
     QStringList arguments = QCoreApplication::arguments();
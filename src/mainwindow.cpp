@@ -1,42 +1,137 @@
+#include <functional>
+#include <memory>
 #include <QFileDialog>
+#include <QFontDatabase>
 #include <QMessageBox>
 #include <QString>
 #include <QTextStream>
 #include <QClipboard>
 #include <QMimeData>
+#include <QProgressBar>
+#include <QToolButton>
+#include <QActionGroup>
+#include <QTimer>
+#include <QtConcurrent>
 #include <QDebug>
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "qglyphlistwidgetitemdelegate.h"
+#include "qglyphlistmodel.h"
+#include "glyphchangebus.h"
 #include "dlgsymbinfo.h"
+#include "dlgspritesheet.h"
+#include "dlgfontdiff.h"
+#include "dlgrescale.h"
+#include "dlgrelayout.h"
+#include "dlgrasterize.h"
 #include "psfutil.h"
+#include "psfbdf.h"
+#include "psfhex.h"
+#include "psfjournal.h"
+#include "psfcompiled.h"
+#include "psfsheet.h"
+#include "psfdiff.h"
+#include "psfresize.h"
+#include "psfrasterize.h"
+
+// Glyphs per row in exported sprite sheets
+static const unsigned SPRITE_SHEET_COLUMNS = 16;
+static const size_t SIMILAR_GLYPHS = 24;
 
 MainWindow::MainWindow(QWidget *parent, const QString &filePath) :
     QMainWindow(parent),
     selectedFilter(""),
-    ui(new Ui::MainWindow)
+    ui(new Ui::MainWindow),
+    loadingNewFont(false),
+    editGeneration(0),
+    savingGeneration(0),
+    saveQueued(false),
+    journalCommitQueued(false)
 {
     ui->setupUi(this);
-    ui->listFontGlyphs->setItemDelegate(new QGlyphListWidgetItemDelegate);
+    glyphModel = new QGlyphListModel(this);
+    ui->listFontGlyphs->setModel(glyphModel);
+    glyphDelegate = new QGlyphListWidgetItemDelegate(this);
+    ui->listFontGlyphs->setItemDelegate(glyphDelegate);
     fileModified = false;
-    connect(ui->widgetGlyphEditor, &QFontGlyphEditor::glyphChanged, this, &MainWindow::on_glyphChanged);
+    connect(ui->listFontGlyphs->selectionModel(), &QItemSelectionModel::currentChanged,
+            this, &MainWindow::on_currentGlyphChanged);
+    changeBus = new GlyphChangeBus(this);
+    connect(ui->widgetGlyphEditor, &QFontGlyphEditor::glyphChanged, changeBus, &GlyphChangeBus::notify);
+    connect(changeBus, &GlyphChangeBus::glyphsChanged, this, &MainWindow::on_glyphsChanged);
+    connect(ui->fontSheetView, &QFontSheetView::glyphClicked, this, &MainWindow::on_sheetGlyphClicked);
+    ui->menuView->addAction(ui->dockFontSheet->toggleViewAction());
+    ui->menuView->addAction(ui->dockSimilarGlyphs->toggleViewAction());
+    ui->menuView->addAction(ui->dockSampleText->toggleViewAction());
+    connect(ui->listSimilarGlyphs, &QListWidget::itemActivated, this, &MainWindow::on_similarGlyphActivated);
+    connect(ui->listSimilarGlyphs, &QListWidget::itemClicked, this, &MainWindow::on_similarGlyphActivated);
+    connect(ui->dockSimilarGlyphs, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+        if (visible) {
+            updateSimilarGlyphs();
+        }
+    });
+
+    QActionGroup *pasteModes = new QActionGroup(this);
+    ui->actionPasteFixed->setData(static_cast<int>(PSFBinarize::Fixed));
+    ui->actionPasteOtsu->setData(static_cast<int>(PSFBinarize::Otsu));
+    ui->actionPasteFloydSteinberg->setData(static_cast<int>(PSFBinarize::FloydSteinberg));
+    ui->actionPasteOrdered->setData(static_cast<int>(PSFBinarize::Ordered));
+    pasteModes->addAction(ui->actionPasteFixed);
+    pasteModes->addAction(ui->actionPasteOtsu);
+    pasteModes->addAction(ui->actionPasteFloydSteinberg);
+    pasteModes->addAction(ui->actionPasteOrdered);
+    connect(pasteModes, &QActionGroup::triggered, this, &MainWindow::on_pasteModeChanged);
+    ui->dockFontSheet->hide();
+    ui->dockSimilarGlyphs->hide();
+
+    ui->edtSampleText->setPlainText(ui->sampleTextView->text());
+    connect(ui->edtSampleText, &QPlainTextEdit::textChanged, this, [this]() {
+        ui->sampleTextView->setText(ui->edtSampleText->toPlainText());
+    });
+    // Zoom levels are 1x, 2x and 4x
+    ui->cmbSampleZoom->setCurrentIndex(1);
+    connect(ui->cmbSampleZoom, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this](int index) {
+        ui->sampleTextView->setZoom(1 << index);
+    });
+    ui->dockSampleText->hide();
+
+    loadProgressBar = new QProgressBar(this);
+    loadProgressBar->setMaximumWidth(200);
+    loadProgressBar->setRange(0, 1000);
+    loadProgressBar->hide();
+    btnCancelLoad = new QToolButton(this);
+    btnCancelLoad->setText("Cancel");
+    btnCancelLoad->hide();
+    statusBar()->addPermanentWidget(loadProgressBar);
+    statusBar()->addPermanentWidget(btnCancelLoad);
+    connect(btnCancelLoad, &QToolButton::clicked, this, &MainWindow::on_cancelLoading);
+    connect(&loadWatcher, &QFutureWatcher<bool>::finished, this, &MainWindow::on_fontLoaded);
+    connect(&saveWatcher, &QFutureWatcher<bool>::finished, this, &MainWindow::on_fontSaved);
+    connect(&journalWatcher, &QFutureWatcher<bool>::finished, this, &MainWindow::on_journalCommitted);
+    loadProgressTimer.setInterval(50);
+    connect(&loadProgressTimer, &QTimer::timeout, this, &MainWindow::on_loadProgressTimer);
 
     if (!filePath.isEmpty()) {
       QFileInfo fi(filePath);
       if (fi.exists()) {
-          currentFile.setFileName(filePath);
-
           QString extension = fi.suffix().toLower();
           if (extension == "psf") {
               selectedFilter = "PSF file (*.psf)";
           } else if (extension == "mif") {
               selectedFilter = "Verilog MIF (*.mif)";
+          } else if (extension == "bdf") {
+              selectedFilter = "BDF file (*.bdf)";
+          } else if (extension == "hex") {
+              selectedFilter = "Unifont HEX (*.hex)";
+          } else if (extension == "psfc") {
+              selectedFilter = "Compiled font (*.psfc)";
           } else {
               QMessageBox::warning(this, "Error", "Unsupported file type: " + extension);
               return;
           }
 
-          on_actionOpenFontFile_triggered();
+          // Let the window show up first, the font streams in afterwards
+          QTimer::singleShot(0, this, [this, filePath]() { openFontFile(filePath); });
       } else {
           QMessageBox::warning(this, "Error", "File does not exist: " + filePath);
       }
@@ -44,55 +139,58 @@ MainWindow::MainWindow(QWidget *parent, const QString &filePath) :
 }
 
 MainWindow::~MainWindow() {
+    loadProgress.cancel();
+    loadWatcher.waitForFinished();
+    waitForPendingSaves();
+    journalWatcher.waitForFinished();
     delete ui;
 }
 
 void MainWindow::on_actionExitApp_triggered() {
+    bool discard = false;
     if (fileModified) {
         int res = QMessageBox::question(this, "Confirmation", "File has been changed. Do you want to save it before exit?",
                                         QMessageBox::Yes, QMessageBox::No);
 
         if (res == QMessageBox::Yes) {
-            saveFontToFile();
+            on_actionSaveFont_triggered();
+        } else {
+            discard = true;
         }
 
     }
+    waitForPendingSaves();
+
+    // Keep the journal only if saving failed
+    journalWatcher.waitForFinished();
+    if (discard || !fileModified) {
+        journal.remove();
+    }
     qApp->exit();
 }
 
 void MainWindow::updateGlyphListWidget() {
-    ui->listFontGlyphs->clear();
-    for (unsigned i = 0; i < font.getNumGlyphs(); i++) {
-        PSFGlyph& glyph = font.getGlyph(i);
-
-        QString itmText = QString::number(i);
-        QListWidgetItem *item = new QListWidgetItem(itmText);
-        item->setData(Qt::DisplayRole, QVariant(itmText));
-        item->setData(Qt::UserRole, QVariant::fromValue(&glyph));
-        ui->listFontGlyphs->addItem(item);
-    }
-    ui->listFontGlyphs->setCurrentRow(0);
+    glyphDelegate->setFont(&font);
+    glyphModel->setFont(&font);
+    ui->fontSheetView->setFont(&font);
+    ui->sampleTextView->setFont(&font);
+    ui->listFontGlyphs->setCurrentIndex(glyphModel->index(0));
+    similarIndex.clear();
     ui->lblFontTitle->setText(QString("Font Symbols (%1x%2)").arg(font.getWidth()).arg(font.getHeight()));
-    ui->listFontGlyphs->repaint();
 
     fileModified = false;
     updateFileInfo();
 }
 
-void MainWindow::on_listFontGlyphs_itemSelectionChanged()
+void MainWindow::on_currentGlyphChanged(const QModelIndex &current)
 {
-    QList<QListWidgetItem*> lstItems = ui->listFontGlyphs->selectedItems();
-
-    if (!lstItems.isEmpty()) {
-        QListWidgetItem *selItem = lstItems.at(0);
-        QString itmText = selItem->text();
-
-        int index = itmText.toShort();
+    if (current.isValid()) {
+        int index = current.row();
         ui->widgetGlyphEditor->setCurrGlyphIndex(index);
-        ui->widgetGlyphEditor->repaint();
         ui->widgetGlyphEditor->enableEditor(true);
+        ui->fontSheetView->setCurrentGlyph(index);
 
-        const PSFGlyph& glyph = font.getGlyph(index);
+        const PSFGlyph& glyph = font.getGlyph(static_cast<unsigned>(index));
         const std::vector<unsigned int>& uvals = glyph.getUnicodeValues();
 
         QString s = "";
@@ -114,21 +212,106 @@ void MainWindow::on_listFontGlyphs_itemSelectionChanged()
         lblText += "</b>";
 
         ui->lblCurrentSymbolIndex->setText(lblText);
+        updateSimilarGlyphs();
     } else {
         ui->widgetGlyphEditor->enableEditor(false);
         ui->lblCurrentSymbolIndex->setText("");
     }
 }
 
-void MainWindow::on_glyphChanged()
+void MainWindow::on_glyphsChanged(const QVector<int> &indices)
 {
-    fileModified = true;
-    updateFileInfo();
+    editGeneration++;
+    for (int index : indices) {
+        glyphModel->glyphChanged(index);
+        ui->fontSheetView->updateGlyph(index);
+        ui->sampleTextView->updateGlyph(index);
+    }
+    if (!fileModified) {
+        fileModified = true;
+        updateFileInfo();
+    }
+
+    for (int index : indices) {
+        journal.record(static_cast<unsigned>(index), font.getGlyph(static_cast<unsigned>(index)));
+    }
+    commitJournal();
+
+    if (!similarIndex.isEmpty()) {
+        for (int index : indices) {
+            similarIndex.update(font, static_cast<unsigned>(index));
+        }
+        updateSimilarGlyphs();
+    }
+}
+
+/*
+ * Flushes the journal on a worker thread. Records queued while a commit is
+ * running go to disk together in the next one.
+ */
+void MainWindow::commitJournal()
+{
+    if (journalWatcher.isRunning()) {
+        journalCommitQueued = true;
+        return;
+    }
+    journalCommitQueued = false;
+    PSFJournal *j = &journal;
+    journalWatcher.setFuture(QtConcurrent::run([j]() { return j->commit(); }));
+}
+
+void MainWindow::on_journalCommitted()
+{
+    if (!journalWatcher.result()) {
+        statusBar()->showMessage("Cannot write the edit journal", 3000);
+    }
+    if (journalCommitQueued) {
+        commitJournal();
+    }
+}
+
+/*
+ * Starts journaling the edits of the font just loaded from <filePath>. If
+ * the file has a journal left over by a crash, the user can recover the
+ * edits it holds.
+ */
+void MainWindow::openJournal(const QString &filePath)
+{
+    std::string path = filePath.toStdString();
+    bool recover = false;
+
+    if (PSFJournal::hasRecords(path)) {
+        int res = QMessageBox::question(this, "Confirmation",
+                                        "There are unsaved changes of '" + filePath + "' from a previous session. "
+                                        "Do you want to recover them?",
+                                        QMessageBox::Yes, QMessageBox::No);
+        if (res == QMessageBox::Yes) {
+            size_t count = 0;
+            recover = PSFJournal::replay(font, path, &count);
+            if (!recover) {
+                QMessageBox::information(this, "Error", "Cannot recover the changes of '" + filePath + "'");
+            }
+        }
+    }
+    journal.open(path, font, recover);
+
+    if (recover) {
+        editGeneration++;
+        ui->widgetGlyphEditor->setFont(&font);
+        updateGlyphListWidget();
+        fileModified = true;
+        updateFileInfo();
+    }
+}
+
+void MainWindow::on_sheetGlyphClicked(int index)
+{
+    ui->listFontGlyphs->setCurrentIndex(glyphModel->index(index));
 }
 
 void MainWindow::updateFileInfo()
 {
-    QFileInfo fileInfo(currentFile);
+    QFileInfo fileInfo(fontFilePath());
     QString windowTitle = "Fixed Size Font editor - " + fileInfo.fileName();
 
     if (fileModified) {
@@ -152,82 +335,325 @@ void MainWindow::on_actionOpenFontFile_triggered()
     QString filePath = QFileDialog::getOpenFileName(this,
                                  tr("Open Font file"),
                                  currFilePath,
-                                 tr("Verilog MIF (*.mif);;PSF file (*.psf)"),
+                                 tr("Verilog MIF (*.mif);;PSF file (*.psf);;BDF file (*.bdf);;Unifont HEX (*.hex);;Compiled font (*.psfc)"),
                                  &selectedFilter,
                                  options);
     if (filePath.isEmpty()) {
         return;
     }
     if (selectedFilter.isEmpty()) {
-        QMessageBox::information(this, "Error", "Unknown file '" + filePath + "'. Please select a MIF or PSF file");
+        QMessageBox::information(this, "Error", "Unknown file '" + filePath + "'. Please select a MIF, PSF, BDF, HEX or PSFC file");
         return;
     }
-    currentFile.setFileName(filePath);
+    openFontFile(filePath);
+}
 
-    bool success;
-    if (selectedFilter.contains("PSF")) {
-        fileType = FileType::PSF;
-        success = font.loadFromFile(filePath.toStdString().c_str());
+/*
+ * Starts loading <filePath> on a worker thread, using the format given by
+ * the selected filter. The current font stays editable until the new one
+ * is swapped in by on_fontLoaded().
+ */
+void MainWindow::openFontFile(const QString &filePath)
+{
+    if (loadWatcher.isRunning()) {
+        return;
+    }
+
+    std::string path = filePath.toStdString();
+    PSFFont *target = &loadingFont;
+    PSFProgress *progress = &loadProgress;
+    std::function<bool()> loader;
+
+    if (selectedFilter.contains("psfc")) {
+        loadingFileType = FileType::PSFC;
+        loader = [target, path]() { return PSF::loadFromCompiled(*target, path); };
+    } else if (selectedFilter.contains("PSF")) {
+        loadingFileType = FileType::PSF;
+        loader = [target, path, progress]() { return target->loadFromFile(path.c_str(), progress); };
+    } else if (selectedFilter.contains("BDF")) {
+        loadingFileType = FileType::BDF;
+        loader = [target, path, progress]() { return PSF::loadFromBdf(*target, path, progress); };
+    } else if (selectedFilter.contains("HEX")) {
+        loadingFileType = FileType::HEX;
+        loader = [target, path, progress]() { return PSF::loadFromUnifontHex(*target, path, progress); };
     } else {
         DlgSymbInfo *dlg = new DlgSymbInfo(this);
         if (dlg->exec() != QDialog::Accepted) {
             return;
         }
-        int gw = dlg->getWidth();
-        int gh = dlg->getHeight();
+        unsigned gw = static_cast<unsigned>(dlg->getWidth());
+        unsigned gh = static_cast<unsigned>(dlg->getHeight());
         dlg->deleteLater();
 
-        fileType = FileType::MIF;
-        success = PSF::loadFromVerilogMif(font, gw, gh, filePath.toStdString());
+        loadingFileType = FileType::MIF;
+        loader = [target, gw, gh, path, progress]() { return PSF::loadFromVerilogMif(*target, gw, gh, path, progress); };
     }
 
-    if (!success) {
-        QMessageBox::information(this, "Error", "Error loading file '" + filePath + "'");
+    startLoading(loader, filePath, false);
+}
+
+/*
+ * Runs <loader> on a worker thread to fill loadingFont, which
+ * on_fontLoaded() then swaps in. <newFont> marks a font created from
+ * scratch: it gets no file, <filePath> is only suggested when it is saved.
+ */
+void MainWindow::startLoading(const std::function<bool()> &loader, const QString &filePath, bool newFont)
+{
+    loadingFilePath = filePath;
+    loadingNewFont = newFont;
+    loadProgress.reset();
+    loadProgressBar->setValue(0);
+    loadProgressBar->show();
+    btnCancelLoad->show();
+    ui->actionOpenFontFile->setEnabled(false);
+    statusBar()->showMessage("Loading " + filePath + " ...");
+
+    // The first save builds on a copy made here instead of copying the
+    // whole font on the GUI thread
+    PSFFont *target = &loadingFont;
+    std::shared_ptr<const PSFFont> *base = &loadingBase;
+    loadingBase.reset();
+    loadWatcher.setFuture(QtConcurrent::run([loader, target, base]() {
+        if (!loader()) {
+            return false;
+        }
+        *base = std::make_shared<const PSFFont>(*target);
+        return true;
+    }));
+    loadProgressTimer.start();
+}
+
+void MainWindow::on_loadProgressTimer()
+{
+    size_t total = loadProgress.getTotal();
+    if (total > 0) {
+        loadProgressBar->setValue(static_cast<int>((loadProgress.getDone() * 1000) / total));
+    }
+}
+
+void MainWindow::on_cancelLoading()
+{
+    loadProgress.cancel();
+}
+
+void MainWindow::on_fontLoaded()
+{
+    loadProgressTimer.stop();
+    loadProgressBar->hide();
+    btnCancelLoad->hide();
+    ui->actionOpenFontFile->setEnabled(true);
+
+    if (!loadWatcher.result()) {
+        loadingFont = PSFFont();
+        if (loadProgress.isCanceled()) {
+            statusBar()->showMessage("Loading canceled", 3000);
+        } else {
+            updateFileInfo();
+            QMessageBox::information(this, "Error", loadingNewFont ? QString("Cannot create the font")
+                                                                   : "Error loading file '" + loadingFilePath + "'");
+        }
+        return;
+    }
+
+    // A new font has no file until it is saved, loadingFilePath is only suggested
+    installNewFont(loadingFont, loadingNewFont ? QString() : loadingFilePath, loadingFileType,
+                   std::move(loadingBase));
+    loadingFont = PSFFont();
+    if (loadingNewFont) {
+        suggestedFilePath = loadingFilePath;
+        fileModified = true;
+        updateFileInfo();
         return;
     }
+    cleanFileName = (fileType == FileType::PSF) ? loadingFilePath : QString();
+    openJournal(loadingFilePath);
+}
+
+/*
+ * Replaces the font with <newFont>, which belongs to <filePath>. The journal
+ * of the old font is kept if it has unsaved edits, so they can be recovered
+ * when that file is opened again. <base>, if given, is a copy of <newFont>
+ * the snapshots of later saves are built from.
+ */
+void MainWindow::installNewFont(PSFFont &newFont, const QString &filePath, FileType type,
+                                std::shared_ptr<const PSFFont> base)
+{
+    // Saves of the old font finish first, then its pending edits are delivered
+    waitForPendingSaves();
+    changeBus->flush();
+    journalWatcher.waitForFinished();
+    if (fileModified) {
+        journal.close();
+    } else {
+        journal.remove();
+    }
+    ui->widgetGlyphEditor->setCurrGlyphIndex(-1);
+    font.swap(newFont);
+    savingSnapshot.reset();
+    saveQueued = false;
+    snapshotBase = std::move(base);
+    editGeneration++;
+
+    currentFile.setFileName(filePath);
+    fileType = type;
+    cleanFileName.clear();
+    suggestedFilePath.clear();
     ui->widgetGlyphEditor->setFont(&font);
     updateGlyphListWidget();
 }
 
+/*
+ * Returns the file the font is saved to or, for a font that has no file
+ * yet, the name suggested for it. Empty if there is no font.
+ */
+QString MainWindow::fontFilePath() const
+{
+    return currentFile.fileName().isEmpty() ? suggestedFilePath : currentFile.fileName();
+}
+
 void MainWindow::on_actionSaveFont_triggered()
 {
+    // A font without a file is saved under a name the user picks
     if (currentFile.fileName().isEmpty()) {
+        on_actionExport_PSFFile_triggered();
         return;
     }
-    if (!saveFontToFile()) {
-        return;
+    saveFontToFile();
+}
+
+/*
+ * Writes <font> to <fileName> in the given format. Runs on a worker thread.
+ */
+static bool writeFontFile(const PSFFont &font, FileType type, const std::string &fileName, bool incremental)
+{
+    try {
+        if (incremental) {
+            return font.saveChangesToFile(fileName.c_str());
+        }
+        switch (type) {
+        case FileType::MIF:
+            return PSF::saveToVerilogMif(font, fileName);
+        case FileType::BDF:
+            return PSF::saveToBdf(font, fileName);
+        case FileType::HEX:
+            return PSF::saveToUnifontHex(font, fileName);
+        case FileType::PSFC:
+            return PSF::saveToCompiled(font, fileName);
+        default:
+            return font.saveToFile(fileName.c_str());
+        }
+    } catch (std::exception &e) {
+        qWarning() << "Error saving font:" << e.what();
+        return false;
     }
-    QMessageBox::information(this, "Message", "File saved to " + currentFile.fileName());
 }
 
-bool MainWindow::saveFontToFile()
+/*
+ * Saves the font to the current file in the background. The glyphs changed
+ * since the last snapshot are copied right away and the worker builds the
+ * new snapshot from them, so editing can go on while it is written. If a
+ * save is already running, a new one is started when it finishes.
+ * PSF files written or loaded before only get the modified glyphs.
+ */
+void MainWindow::saveFontToFile()
 {
-    QString fileName = currentFile.fileName();
+    if (savingSnapshot) {
+        saveQueued = true;
+        return;
+    }
+    changeBus->flush();
 
-    if (fileType == FileType::MIF) {
-        if (!PSF::saveToVerilogMif(font, fileName.toStdString())) {
-            QMessageBox::information(nullptr, "Error", "Cannot write file '" + fileName + "'");
-            return false;
+    std::shared_ptr<const PSFFont> base = snapshotBase;
+    std::shared_ptr<PSFFontChanges> changes = std::make_shared<PSFFontChanges>();
+    std::shared_ptr<PSFFont> snapshot;
+    if (base && font.getChangesSince(*base, *changes)) {
+        snapshot = std::make_shared<PSFFont>();
+    } else {
+        // Nothing to build on, the whole font is copied
+        snapshot = std::make_shared<PSFFont>(font);
+        changes.reset();
+    }
+    FileType type = fileType;
+    std::string fileName = currentFile.fileName().toStdString();
+    bool incremental = (type == FileType::PSF && cleanFileName == currentFile.fileName());
+
+    savingSnapshot = snapshot;
+    savingFileName = currentFile.fileName();
+    savingFileType = type;
+    savingGeneration = editGeneration;
+    saveWatcher.setFuture(QtConcurrent::run([base, changes, snapshot, type, fileName, incremental]() {
+        if (changes) {
+            *snapshot = *base;
+            snapshot->applyChanges(std::move(*changes));
         }
+        return writeFontFile(*snapshot, type, fileName, incremental);
+    }));
+}
+
+void MainWindow::on_fontSaved()
+{
+    // waitForPendingSaves() may have handled the save already, or started
+    // the queued one this notice is not about
+    if (savingSnapshot && saveWatcher.isFinished()) {
+        finishSave();
+    }
+}
+
+/*
+ * Handles the result of the save that just finished, and starts the
+ * queued one if any. savingSnapshot is set from the start of a save until
+ * it is handled here.
+ */
+void MainWindow::finishSave()
+{
+    if (!saveWatcher.result()) {
+        QMessageBox::information(this, "Error", "Cannot write file '" + savingFileName + "'");
     } else {
-        if (!font.saveToFile(qPrintable(fileName))) {
-            QMessageBox::information(nullptr, "Error", "Cannot write file '" + fileName + "'");
-            return false;
+        if (savingFileType == FileType::PSF) {
+            font.markSaved(*savingSnapshot);
+            cleanFileName = savingFileName;
+        }
+        snapshotBase = savingSnapshot;
+
+        // The file now holds the snapshot, edits made since go to a fresh journal
+        changeBus->flush();
+        journalWatcher.waitForFinished();
+        journal.rebase(savingFileName.toStdString(), *savingSnapshot, font);
+        commitJournal();
+
+        // Edits made while saving keep the font marked as modified
+        if (savingGeneration == editGeneration && fileModified) {
+            fileModified = false;
+            updateFileInfo();
         }
+        statusBar()->showMessage("File saved to " + savingFileName, 3000);
     }
-    fileModified = false;
-    updateFileInfo();
+    savingSnapshot.reset();
+
+    if (saveQueued) {
+        saveQueued = false;
+        saveFontToFile();
+    }
+}
 
-    return true;
+/*
+ * Blocks until the running save and any queued one are written.
+ */
+void MainWindow::waitForPendingSaves()
+{
+    while (savingSnapshot) {
+        saveWatcher.waitForFinished();
+        finishSave();
+    }
 }
 
 void MainWindow::on_actionExport_VerilogMIF_triggered()
 {
-    if (currentFile.fileName().isEmpty()) {
+    if (fontFilePath().isEmpty()) {
         return;
     }
 
-    QFileInfo fi(currentFile);
+    QFileInfo fi(fontFilePath());
     QString filePath = QFileDialog::getSaveFileName(this,
                                  tr("Save as Verilog MIF"),
                                  fi.path(),
@@ -246,22 +672,19 @@ void MainWindow::on_actionExport_VerilogMIF_triggered()
 
     currentFile.setFileName(filePath);
     fileType = FileType::MIF;
-    if (!saveFontToFile()) {
-        return;
-    }
-    QMessageBox::information(this, "Message", "File saved to " + filePath);
+    saveFontToFile();
 }
 
 void MainWindow::on_actionExport_PSFFile_triggered()
 {
-    if (currentFile.fileName().isEmpty()) {
+    if (fontFilePath().isEmpty()) {
         return;
     }
 
-    QFileInfo fi(currentFile);
+    QFileInfo fi(fontFilePath());
     QString filePath = QFileDialog::getSaveFileName(this,
                                  tr("Save as PSF file"),
-                                 fi.path(),
+                                 currentFile.fileName().isEmpty() ? suggestedFilePath : fi.path(),
                                  tr("PSF files (*.psf);;All Files (*)"));
 
     if (filePath.isEmpty()) {
@@ -273,16 +696,15 @@ void MainWindow::on_actionExport_PSFFile_triggered()
     if (!fileName.endsWith(".psf")) {
         fileName += ".psf";
         fi.setFile(fi.dir(), fileName);
-        filePath = fi.absolutePath();
+        filePath = fi.absoluteFilePath();
     }
 
     currentFile.setFileName(filePath);
     fileType = FileType::PSF;
+    suggestedFilePath.clear();
+    updateFileInfo();
 
-    if (!saveFontToFile()) {
-        return;
-    }
-    QMessageBox::information(this, "Message", "File saved to " + filePath);
+    saveFontToFile();
 }
 
 void MainWindow::on_actionCopy_glyph_triggered()
@@ -303,7 +725,8 @@ void MainWindow::on_actionCut_glyph_triggered()
 
         on_actionCopy_glyph_triggered();
         glyph.init(&font);
-        ui->widgetGlyphEditor->repaint();
+        ui->widgetGlyphEditor->update();
+        changeBus->notify(ui->widgetGlyphEditor->getCurrGlyphIndex());
     }
 }
 
@@ -320,10 +743,436 @@ void MainWindow::on_actionPaste_glyph_triggered()
     if (clip_data->hasText()) {
         QString text = clip_data->text();
         PSF::setGlyphFromText(glyph, text);
-        ui->widgetGlyphEditor->repaint();
+        ui->widgetGlyphEditor->update();
+        changeBus->notify(ui->widgetGlyphEditor->getCurrGlyphIndex());
     } else if (clip_data->hasImage()) {
        QImage img = clipboard->image();
-       PSF::setGlyphFromImage(glyph, img);
-       ui->widgetGlyphEditor->repaint();
+       PSF::setGlyphFromImage(glyph, img, pasteOptions);
+       ui->widgetGlyphEditor->update();
+       changeBus->notify(ui->widgetGlyphEditor->getCurrGlyphIndex());
+    }
+}
+
+void MainWindow::on_pasteModeChanged(QAction *action)
+{
+    pasteOptions.mode = static_cast<PSFBinarize>(action->data().toInt());
+}
+
+void MainWindow::on_actionPasteScale_toggled(bool checked)
+{
+    pasteOptions.scale = checked;
+}
+
+void MainWindow::on_actionExport_BDFFile_triggered()
+{
+    if (fontFilePath().isEmpty()) {
+        return;
+    }
+
+    QFileInfo fi(fontFilePath());
+    QString filePath = QFileDialog::getSaveFileName(this,
+                                 tr("Save as BDF file"),
+                                 fi.path(),
+                                 tr("BDF files (*.bdf);;All Files (*)"));
+
+    if (filePath.isEmpty()) {
+        return;
+    }
+
+    fi.setFile(filePath);
+    QString fileName = fi.fileName();
+    if (!fileName.endsWith(".bdf")) {
+        fileName += ".bdf";
+        fi.setFile(fi.dir(), fileName);
+        filePath = fi.absoluteFilePath();
+    }
+
+    currentFile.setFileName(filePath);
+    fileType = FileType::BDF;
+
+    saveFontToFile();
+}
+
+void MainWindow::on_actionExport_HEXFile_triggered()
+{
+    if (fontFilePath().isEmpty()) {
+        return;
+    }
+    if (font.getHeight() != 16) {
+        QMessageBox::information(this, "Error", "Unifont HEX files can only hold 16 pixel high glyphs");
+        return;
+    }
+
+    QFileInfo fi(fontFilePath());
+    QString filePath = QFileDialog::getSaveFileName(this,
+                                 tr("Save as Unifont HEX file"),
+                                 fi.path(),
+                                 tr("Unifont HEX files (*.hex);;All Files (*)"));
+
+    if (filePath.isEmpty()) {
+        return;
+    }
+
+    fi.setFile(filePath);
+    QString fileName = fi.fileName();
+    if (!fileName.endsWith(".hex")) {
+        fileName += ".hex";
+        fi.setFile(fi.dir(), fileName);
+        filePath = fi.absoluteFilePath();
+    }
+
+    currentFile.setFileName(filePath);
+    fileType = FileType::HEX;
+
+    saveFontToFile();
+}
+
+void MainWindow::on_actionExport_CompiledFont_triggered()
+{
+    if (fontFilePath().isEmpty()) {
+        return;
+    }
+
+    QFileInfo fi(fontFilePath());
+    QString filePath = QFileDialog::getSaveFileName(this,
+                                 tr("Save as compiled font"),
+                                 fi.path(),
+                                 tr("Compiled fonts (*.psfc);;All Files (*)"));
+
+    if (filePath.isEmpty()) {
+        return;
+    }
+
+    fi.setFile(filePath);
+    QString fileName = fi.fileName();
+    if (!fileName.endsWith(".psfc")) {
+        fileName += ".psfc";
+        fi.setFile(fi.dir(), fileName);
+        filePath = fi.absoluteFilePath();
+    }
+
+    currentFile.setFileName(filePath);
+    fileType = FileType::PSFC;
+
+    saveFontToFile();
+}
+
+void MainWindow::on_actionExport_SpriteSheet_triggered()
+{
+    if (font.getNumGlyphs() == 0) {
+        return;
+    }
+
+    QFileInfo fi(currentFile);
+    QString filePath = QFileDialog::getSaveFileName(this,
+                                 tr("Save as sprite sheet"),
+                                 fi.path(),
+                                 tr("PNG images (*.png);;All Files (*)"));
+
+    if (filePath.isEmpty()) {
+        return;
+    }
+
+    fi.setFile(filePath);
+    QString fileName = fi.fileName();
+    if (!fileName.endsWith(".png")) {
+        fileName += ".png";
+        fi.setFile(fi.dir(), fileName);
+        filePath = fi.absoluteFilePath();
+    }
+
+    changeBus->flush();
+    if (!PSF::saveToSpriteSheet(font, filePath, SPRITE_SHEET_COLUMNS)) {
+        QMessageBox::information(this, "Error", "Cannot write file '" + filePath + "'");
+        return;
+    }
+    statusBar()->showMessage("Sprite sheet saved to " + filePath, 3000);
+}
+
+/*
+ * Slices a sprite sheet into glyphs of the current font. Without a font, a
+ * new one with the cell size is created, to be saved next to the image.
+ */
+void MainWindow::on_actionImport_SpriteSheet_triggered()
+{
+    if (loadWatcher.isRunning()) {
+        return;
+    }
+
+    QFileInfo fi(currentFile);
+    QString currFilePath = currentFile.fileName().isEmpty() ? QDir::homePath() : fi.absolutePath();
+    QString imagePath = QFileDialog::getOpenFileName(this,
+                                 tr("Import sprite sheet"),
+                                 currFilePath,
+                                 tr("Images (*.png *.bmp *.gif *.jpg *.jpeg *.pbm *.pgm *.ppm *.xpm);;All Files (*)"));
+    if (imagePath.isEmpty()) {
+        return;
     }
+    QImage sheet(imagePath);
+    if (sheet.isNull()) {
+        QMessageBox::information(this, "Error", "Cannot read image '" + imagePath + "'");
+        return;
+    }
+
+    bool newFont = (font.getNumGlyphs() == 0);
+    DlgSpriteSheet dlg(this, newFont ? 8 : font.getWidth(), newFont ? 16 : font.getHeight());
+    if (dlg.exec() != QDialog::Accepted) {
+        return;
+    }
+    PSFSheetLayout layout = dlg.getLayout();
+    std::vector<unsigned> codepoints;
+    if (!dlg.getCodepointFile().isEmpty() && !PSF::readCodepointList(dlg.getCodepointFile(), codepoints)) {
+        QMessageBox::information(this, "Error", "Invalid code point order file '" + dlg.getCodepointFile() + "'");
+        return;
+    }
+
+    changeBus->flush();
+    unsigned oldCount = font.getNumGlyphs();
+    ui->widgetGlyphEditor->setCurrGlyphIndex(-1);
+    if (newFont) {
+        font.init(PSFVersion::V2, layout.cellWidth, layout.cellHeight);
+    }
+    int count = PSF::loadFromSpriteSheet(font, sheet, layout, codepoints);
+    if (count < 0) {
+        ui->widgetGlyphEditor->setCurrGlyphIndex(newFont ? -1 : ui->listFontGlyphs->currentIndex().row());
+        QString msg = "The sprite sheet grid does not fit in the image";
+        if (count == -2) {
+            msg = "A PSF version 1 font cannot hold more than 512 glyphs";
+        } else if (count == -3) {
+            msg = "A PSF version 1 font cannot hold code points above U+FFFF";
+        }
+        QMessageBox::information(this, "Error", msg);
+        return;
+    }
+
+    if (newFont) {
+        QFileInfo ii(imagePath);
+        currentFile.setFileName(ii.path() + "/" + ii.completeBaseName() + ".psf");
+        fileType = FileType::PSF;
+        cleanFileName.clear();
+        ui->widgetGlyphEditor->setFont(&font);
+    }
+    // The glyph list is rebuilt when glyphs were added
+    if (newFont || font.getNumGlyphs() != oldCount) {
+        updateGlyphListWidget();
+    } else {
+        ui->widgetGlyphEditor->setCurrGlyphIndex(ui->listFontGlyphs->currentIndex().row());
+    }
+    for (int i = 0; i < count; ++i) {
+        changeBus->notify(static_cast<int>(layout.startIndex) + i);
+    }
+    changeBus->flush();
+    if (!codepoints.empty()) {
+        ui->sampleTextView->refreshMapping();
+    }
+}
+
+void MainWindow::on_actionCompareFont_triggered()
+{
+    if (font.getNumGlyphs() == 0) {
+        return;
+    }
+
+    QFileInfo fi(currentFile);
+    QString currFilePath = currentFile.fileName().isEmpty() ? QDir::homePath() : fi.absolutePath();
+    QString filePath = QFileDialog::getOpenFileName(this,
+                                 tr("Compare with font file"),
+                                 currFilePath,
+                                 tr("Font files (*.psf *.psfu *.psfc *.bdf *.hex);;All Files (*)"));
+    if (filePath.isEmpty()) {
+        return;
+    }
+
+    changeBus->flush();
+    PSFFont other;
+    PSFFontDiff diff;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool loaded = PSF::loadFontFile(other, filePath.toStdString());
+    bool compared = loaded && PSF::diffFonts(font, other, diff);
+    QApplication::restoreOverrideCursor();
+
+    if (!loaded) {
+        QMessageBox::information(this, "Error", "Cannot load font '" + filePath + "'");
+        return;
+    }
+    if (!compared) {
+        QMessageBox::information(this, "Error", "The glyph sizes of the fonts differ");
+        return;
+    }
+    if (diff.identical()) {
+        QMessageBox::information(this, "Compare fonts", "The fonts are identical");
+        return;
+    }
+
+    DlgFontDiff dlg(this, font, other, diff, fi.fileName(), QFileInfo(filePath).fileName());
+    dlg.exec();
+}
+
+/*
+ * Fills the similar glyphs dock with the glyphs closest to the current
+ * one. The index is built on first use and kept up to date by
+ * on_glyphsChanged(), so this runs on every edit while the dock is open.
+ */
+void MainWindow::updateSimilarGlyphs()
+{
+    if (!ui->dockSimilarGlyphs->isVisible() || !ui->widgetGlyphEditor->hasGlyph()) {
+        return;
+    }
+    if (similarIndex.isEmpty()) {
+        similarIndex.build(font);
+    }
+
+    int current = ui->widgetGlyphEditor->getCurrGlyphIndex();
+    std::vector<unsigned char> bits = font.getGlyph(static_cast<unsigned>(current)).getData();
+    bits.resize(font.getGlyphSize(), 0);
+    std::vector<GlyphMatch> matches = similarIndex.nearest(bits.data(), SIMILAR_GLYPHS, current);
+
+    QSize iconSize(static_cast<int>(font.getWidth()) * 2, static_cast<int>(font.getHeight()) * 2);
+    ui->listSimilarGlyphs->setIconSize(iconSize);
+    ui->listSimilarGlyphs->clear();
+    for (const GlyphMatch &m : matches) {
+        QImage img = PSF::glyphToImage(font.getGlyph(m.index)).scaled(iconSize);
+        QListWidgetItem *item = new QListWidgetItem(QIcon(QPixmap::fromImage(img)),
+                                                    QString("%1 (%2)").arg(m.index).arg(m.distance));
+        item->setData(Qt::UserRole, m.index);
+        ui->listSimilarGlyphs->addItem(item);
+    }
+}
+
+void MainWindow::on_actionFindSimilar_triggered()
+{
+    ui->dockSimilarGlyphs->show();
+    ui->dockSimilarGlyphs->raise();
+    updateSimilarGlyphs();
+}
+
+void MainWindow::on_similarGlyphActivated(QListWidgetItem *item)
+{
+    ui->listFontGlyphs->setCurrentIndex(glyphModel->index(item->data(Qt::UserRole).toInt()));
+}
+
+/*
+ * Replaces the font with <resized>, a copy of it with other glyph
+ * dimensions. The journal holds glyphs of the old size, so it is dropped;
+ * the next save starts a new one.
+ */
+void MainWindow::installResizedFont(PSFFont &resized)
+{
+    waitForPendingSaves();
+    changeBus->flush();
+    journalWatcher.waitForFinished();
+    journal.remove();
+
+    int current = ui->widgetGlyphEditor->getCurrGlyphIndex();
+    ui->widgetGlyphEditor->setCurrGlyphIndex(-1);
+    font.swap(resized);
+    // Nothing saved before may serve as the base of the next snapshot
+    savingSnapshot.reset();
+    saveQueued = false;
+    snapshotBase.reset();
+    editGeneration++;
+    ui->widgetGlyphEditor->setFont(&font);
+    updateGlyphListWidget();
+    if (current >= 0) {
+        ui->listFontGlyphs->setCurrentIndex(glyphModel->index(current));
+    }
+    fileModified = true;
+    updateFileInfo();
+}
+
+void MainWindow::on_actionRescaleFont_triggered()
+{
+    if (font.getNumGlyphs() == 0 || loadWatcher.isRunning()) {
+        return;
+    }
+    DlgRescale dlg(this, font.getWidth(), font.getHeight());
+    if (dlg.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    changeBus->flush();
+    PSFFont scaled;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool ok = PSF::rescaleFont(font, scaled, dlg.getWidth(), dlg.getHeight(), dlg.getMode(), dlg.getCoverage());
+    QApplication::restoreOverrideCursor();
+    if (!ok) {
+        QMessageBox::information(this, "Error", QString("Cannot rescale the font to %1x%2 with the selected algorithm")
+                                 .arg(dlg.getWidth()).arg(dlg.getHeight()));
+        return;
+    }
+    installResizedFont(scaled);
+    statusBar()->showMessage(QString("Font rescaled to %1x%2").arg(font.getWidth()).arg(font.getHeight()), 3000);
+}
+
+void MainWindow::on_actionResizeCanvas_triggered()
+{
+    if (font.getNumGlyphs() == 0 || loadWatcher.isRunning()) {
+        return;
+    }
+    changeBus->flush();
+    DlgRelayout dlg(this, font, PSF::fontBoundingBox(font));
+    if (dlg.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    qint64 oldBytes = static_cast<qint64>(font.getGlyphSize()) * font.getNumGlyphs();
+    PSFFont resized;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    PSF::relayoutFont(font, resized, dlg.getWidth(), dlg.getHeight(), dlg.getShiftX(), dlg.getShiftY());
+    QApplication::restoreOverrideCursor();
+    installResizedFont(resized);
+
+    qint64 newBytes = static_cast<qint64>(font.getGlyphSize()) * font.getNumGlyphs();
+    QString msg = QString("Glyphs resized to %1x%2").arg(font.getWidth()).arg(font.getHeight());
+    if (newBytes < oldBytes) {
+        msg += QString(", %1 bytes saved").arg(oldBytes - newBytes);
+    }
+    statusBar()->showMessage(msg, 5000);
+}
+
+void MainWindow::on_actionImport_SystemFont_triggered()
+{
+    if (loadWatcher.isRunning()) {
+        return;
+    }
+    DlgRasterize dlg(this);
+    if (dlg.exec() != QDialog::Accepted) {
+        return;
+    }
+    std::vector<unsigned> codepoints;
+    if (!PSF::parseCodepointRanges(dlg.getRanges(), codepoints) || codepoints.empty()) {
+        QMessageBox::information(this, "Error", "Invalid code point list '" + dlg.getRanges() + "'");
+        return;
+    }
+
+    QFont qfont = dlg.getFont();
+    PSFRasterOptions opt = dlg.getOptions();
+    QString name = QString("%1-%2x%3.psf").arg(qfont.family().remove(' ')).arg(opt.width).arg(opt.height);
+    QFileInfo fi(currentFile);
+    QString dir = currentFile.fileName().isEmpty() ? QDir::homePath() : fi.absolutePath();
+
+    // Without threaded font rendering, text can only be drawn on the GUI thread
+    if (!QFontDatabase::supportsThreadedFontRendering()) {
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        int count = PSF::rasterizeFont(loadingFont, qfont, codepoints, opt, nullptr);
+        QApplication::restoreOverrideCursor();
+        if (count <= 0) {
+            loadingFont = PSFFont();
+            QMessageBox::information(this, "Error", "Cannot create the font");
+            return;
+        }
+        installNewFont(loadingFont, QString(), FileType::PSF);
+        loadingFont = PSFFont();
+        suggestedFilePath = dir + "/" + name;
+        fileModified = true;
+        updateFileInfo();
+        return;
+    }
+
+    loadingFileType = FileType::PSF;
+    PSFFont *target = &loadingFont;
+    PSFProgress *progress = &loadProgress;
+    startLoading([target, qfont, codepoints, opt, progress]() {
+        return PSF::rasterizeFont(*target, qfont, codepoints, opt, progress) > 0;
+    }, dir + "/" + name, true);
 }
@@ -12,13 +12,28 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <QDebug>
 #include "psf.h"
 #include "mini_utf8.h"
+#include "psfparallel.h"
+
+// Minimum amount of unicode table records decoded by a worker
+static const size_t UNICODE_MIN_CHUNK_GLYPHS = 4096;
 
 void PSFFont::init(PSFVersion version, unsigned int width, unsigned int height)
 {
     this->version = version;
+    memset(&header, 0, sizeof(header));
+    glyphv.clear();
+    layout_generation++;
 
     if (version == PSFVersion::V1) {
         header.psf1.charsize = static_cast<unsigned char>(height);
@@ -38,6 +53,49 @@ void PSFFont::init(PSFVersion version, unsigned int width, unsigned int height)
     }
 }
 
+PSFFont::PSFFont(const PSFFont& other) :
+    version(other.version),
+    header(other.header),
+    glyphv(other.glyphv),
+    layout_generation(other.layout_generation),
+    saved_layout_generation(other.saved_layout_generation)
+{
+    attachGlyphs();
+}
+
+PSFFont& PSFFont::operator=(const PSFFont& other)
+{
+    if (this != &other) {
+        version = other.version;
+        header = other.header;
+        glyphv = other.glyphv;
+        layout_generation = other.layout_generation;
+        saved_layout_generation = other.saved_layout_generation;
+        attachGlyphs();
+    }
+    return *this;
+}
+
+void PSFFont::swap(PSFFont& other)
+{
+    std::swap(version, other.version);
+    std::swap(header, other.header);
+    glyphv.swap(other.glyphv);
+    std::swap(layout_generation, other.layout_generation);
+    std::swap(saved_layout_generation, other.saved_layout_generation);
+    attachGlyphs();
+    other.attachGlyphs();
+}
+
+void PSFFont::attachGlyphs()
+{
+    for (PSFGlyph& glyph : glyphv) {
+        if (glyph.font != nullptr) {
+            glyph.font = this;
+        }
+    }
+}
+
 static int psf_read_byte(std::ifstream& file, unsigned int *bval)
 {
     int rd = file.get();
@@ -49,7 +107,7 @@ static int psf_read_byte(std::ifstream& file, unsigned int *bval)
 	return 1;
 }
 
-static int psf_write_byte(std::ofstream& file, unsigned int bval)
+static int psf_write_byte(std::ostream& file, unsigned int bval)
 {
     file.put(static_cast<char>(bval & 0xff));
     if (file.bad()) {
@@ -69,7 +127,7 @@ static int psf_read_word(std::ifstream& file, unsigned int *wval)
 	return 1;
 }
 
-static int psf_write_word(std::ofstream& file, unsigned int wval)
+static int psf_write_word(std::ostream& file, unsigned int wval)
 {
 	unsigned int byte0, byte1;
 	byte0 = wval & 0xff;
@@ -87,7 +145,7 @@ static int psf_read_int(std::ifstream& file, unsigned int *ival)
 	return 1;
 }
 
-static int psf_write_int(std::ofstream& file, unsigned int ival)
+static int psf_write_int(std::ostream& file, unsigned int ival)
 {
 	unsigned int byte0, byte1, byte2, byte3;
 	byte0 = ival & 0xff;
@@ -97,10 +155,17 @@ static int psf_write_int(std::ofstream& file, unsigned int ival)
 	return psf_write_byte(file, byte0) && psf_write_byte(file, byte1) && psf_write_byte(file, byte2) && psf_write_byte(file, byte3);
 }
 
-bool PSFFont::readGlyphs(std::ifstream &file, unsigned int numglyphs, unsigned int glyphsize)
+bool PSFFont::readGlyphs(std::ifstream &file, unsigned int numglyphs, unsigned int glyphsize, PSFProgress *progress)
 {
     glyphv.resize(numglyphs);
+    if (progress != nullptr) {
+        progress->setTotal(numglyphs);
+    }
     for (unsigned index = 0; index < numglyphs; ++index) {
+        if (progress != nullptr) {
+            if (progress->isCanceled()) { return false; }
+            progress->advance();
+        }
         std::vector<unsigned char> gdata(glyphsize);
         file.read(reinterpret_cast<char *>(gdata.data()), glyphsize);
 
@@ -126,7 +191,7 @@ bool PSFFont::psf1ReadUnicodeVals(std::ifstream &file, unsigned int numglyphs)
     return true;
 }
 
-bool PSFFont::psf1LoadFromFile(std::ifstream& file)
+bool PSFFont::psf1LoadFromFile(std::ifstream& file, PSFProgress *progress)
 {
 	unsigned char magic[2];
 	magic[0] = PSF1_MAGIC0;
@@ -147,7 +212,7 @@ bool PSFFont::psf1LoadFromFile(std::ifstream& file)
     header.psf1.mode = static_cast<unsigned char>(mode);
 
 	int numglyphs = (mode & PSF1_MODE512) ? 512 : 256;
-    if (!readGlyphs(file, numglyphs, height)) {
+    if (!readGlyphs(file, numglyphs, height, progress)) {
         return false;
 	}
 
@@ -180,35 +245,54 @@ bool PSFFont::psf2ReadUnicodeVals(std::ifstream &file, unsigned int numglyphs)
         return false;
     }
 
-    unsigned int size = udata.size();
-    unsigned char *ptr = udata.data(), *end = udata.data() + size;
+    // 0xFF never shows up in UTF-8, so the glyph records are found without
+    // decoding them
+    const unsigned char *buf = udata.data();
+    size_t size = udata.size(), pos = 0;
+    std::vector<size_t> recEnd(numglyphs);
     for (unsigned i = 0; i < numglyphs; ++i) {
-        PSFGlyph& glyph = glyphv[i];
-		int ucval;
-		while (1) {
-			if (ptr >= end) {
-				fprintf(stderr, "%s: unexpected end of file\n", __func__);
-				return 0;
-			}
-			if (*ptr == PSF2_SEPARATOR) { ++ptr; break; }
-			if (*ptr == PSF2_STARTSEQ) {
-				++ptr;
-				ucval = PSF1_STARTSEQ;
-			} else {
-                ucval = mini_utf8_decode(const_cast<const char **>(reinterpret_cast<char **>(&ptr)));
-				if (ucval < 0) {
-					fprintf(stderr, "%s: invalid utf8 char\n", __func__);
-					return 0;
-				}
-			}
-            glyph.addUnicodeVal(static_cast<unsigned>(ucval) & 0x1FFFFF);
-		}
-	}
+        const void *sep = (pos < size) ? memchr(buf + pos, PSF2_SEPARATOR, size - pos) : nullptr;
+        if (sep == nullptr) {
+            fprintf(stderr, "%s: unexpected end of file\n", __func__);
+            return false;
+        }
+        recEnd[i] = static_cast<size_t>(static_cast<const unsigned char *>(sep) - buf);
+        pos = recEnd[i] + 1;
+    }
 
-	return 1;
+    // Then every worker decodes a range of records straight into the glyphs
+    std::vector<char> chunkOk(PSF::chunkCount(numglyphs, UNICODE_MIN_CHUNK_GLYPHS), 1);
+    PSF::parallelChunks(numglyphs, UNICODE_MIN_CHUNK_GLYPHS, [&](unsigned chunk, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const unsigned char *ptr = buf + ((i == 0) ? 0 : recEnd[i - 1] + 1);
+            const unsigned char *rend = buf + recEnd[i];
+            std::vector<unsigned int>& vals = glyphv[i].unicode_vals;
+
+            while (ptr < rend) {
+                if (*ptr == PSF2_STARTSEQ) {
+                    ++ptr;
+                    vals.push_back(PSF1_STARTSEQ);
+                    continue;
+                }
+                int ucval = mini_utf8_decode(reinterpret_cast<const char **>(&ptr));
+                if (ucval < 0) {
+                    chunkOk[chunk] = 0;
+                    return;
+                }
+                vals.push_back(static_cast<unsigned>(ucval) & 0x1FFFFF);
+            }
+        }
+    });
+    layout_generation++;
+
+    if (std::find(chunkOk.begin(), chunkOk.end(), 0) != chunkOk.end()) {
+        fprintf(stderr, "%s: invalid utf8 char\n", __func__);
+        return false;
+    }
+    return true;
 }
 
-bool PSFFont::psf2LoadFromFile(std::ifstream& file)
+bool PSFFont::psf2LoadFromFile(std::ifstream& file, PSFProgress *progress)
 {
 	unsigned char magic[4];
 	magic[0] = PSF2_MAGIC0;
@@ -240,7 +324,7 @@ bool PSFFont::psf2LoadFromFile(std::ifstream& file)
     header.psf2.width = width;
     header.psf2.height = height;
 
-    if (!readGlyphs(file, length, charsize)) {
+    if (!readGlyphs(file, length, charsize, progress)) {
         return false;
 	}
 
@@ -251,30 +335,34 @@ bool PSFFont::psf2LoadFromFile(std::ifstream& file)
     return true;
 }
 
-bool PSFFont::loadFromFile(std::ifstream &file)
+bool PSFFont::loadFromFile(std::ifstream &file, PSFProgress *progress)
 {
     int byte = file.get();
+    bool ok = false;
 	if (byte == PSF1_MAGIC0) {
-        return psf1LoadFromFile(file);
+        ok = psf1LoadFromFile(file, progress);
 	} else if (byte == PSF2_MAGIC0) {
-        return psf2LoadFromFile(file);
+        ok = psf2LoadFromFile(file, progress);
 	} else {
 		fprintf(stderr, "%s: invalid magic number", __func__);
 	}
-    return false;
+    if (ok) {
+        markClean();
+    }
+    return ok;
 }
 
-bool PSFFont::loadFromFile(const char *filename)
+bool PSFFont::loadFromFile(const char *filename, PSFProgress *progress)
 {
     std::ifstream file(filename, std::ios::in|std::ios::binary);
     if (!file.is_open()) {
 		perror(__func__);
         return false;
 	}
-    return loadFromFile(file);
+    return loadFromFile(file, progress);
 }
 
-bool PSFFont::writeDummy(std::ofstream &file, unsigned int size) const
+bool PSFFont::writeDummy(std::ostream &file, unsigned int size) const
 {
     for (unsigned i = 0; i < size; ++i) {
         file.put('\0');
@@ -283,7 +371,7 @@ bool PSFFont::writeDummy(std::ofstream &file, unsigned int size) const
     return true;
 }
 
-bool PSFFont::writeGlyphs(std::ofstream &file) const
+bool PSFFont::writeGlyphs(std::ostream &file) const
 {
     unsigned int numglyphs = glyphv.size();
     unsigned int glyphsize = getGlyphSize();
@@ -307,7 +395,7 @@ bool PSFFont::writeGlyphs(std::ofstream &file) const
     return true;
 }
 
-bool PSFFont::psf1WriteUnicodeVals(std::ofstream &file) const
+bool PSFFont::psf1WriteUnicodeVals(std::ostream &file) const
 {
     for (unsigned i = 0; i < glyphv.size(); ++i) {
         for (unsigned ucv = 0; ucv < glyphv[i].unicode_vals.size(); ++ucv) {
@@ -318,7 +406,7 @@ bool PSFFont::psf1WriteUnicodeVals(std::ofstream &file) const
     return true;
 }
 
-bool PSFFont::psf1SaveToFile(std::ofstream &file) const
+bool PSFFont::psf1SaveToFile(std::ostream &file) const
 {
     if (!psf_write_byte(file, header.psf1.magic[0])) { return false; }
     if (!psf_write_byte(file, header.psf1.magic[1])) { return false; }
@@ -337,7 +425,7 @@ bool PSFFont::psf1SaveToFile(std::ofstream &file) const
 	return 1;
 }
 
-bool PSFFont::psf2WriteUnicodeVals(std::ofstream &file) const
+bool PSFFont::psf2WriteUnicodeVals(std::ostream &file) const
 {
 	char u8buf[8];
     unsigned int numglyphs = glyphv.size();
@@ -364,7 +452,7 @@ bool PSFFont::psf2WriteUnicodeVals(std::ofstream &file) const
     return true;
 }
 
-bool PSFFont::psf2SaveToFile(std::ofstream &file) const
+bool PSFFont::psf2SaveToFile(std::ostream &file) const
 {
     for (int i = 0; i < 4; ++i) {
         if (!psf_write_byte(file, header.psf2.magic[i])) { return false; }
@@ -400,6 +488,198 @@ bool PSFFont::saveToFile(const char *filename) const
     return saveToFile(file);
 }
 
+static void psf_put_int(unsigned char *p, unsigned int ival)
+{
+    p[0] = ival & 0xff;
+    p[1] = (ival >> 8) & 0xff;
+    p[2] = (ival >> 16) & 0xff;
+    p[3] = (ival >> 24) & 0xff;
+}
+
+static bool psf_pwrite_all(int fd, const unsigned char *buf, size_t len, off_t offset)
+{
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, offset);
+        if (n < 0) {
+            if (errno == EINTR) { continue; }
+            return false;
+        }
+        buf += n;
+        len -= static_cast<size_t>(n);
+        offset += n;
+    }
+    return true;
+}
+
+/*
+ * Returns the header exactly as psf1SaveToFile()/psf2SaveToFile() write it.
+ * The glyph bitmaps follow it directly.
+ */
+std::vector<unsigned char> PSFFont::headerBytes() const
+{
+    std::vector<unsigned char> hdr;
+    if (version == PSFVersion::V1) {
+        hdr = { header.psf1.magic[0], header.psf1.magic[1], header.psf1.mode, header.psf1.charsize };
+    } else {
+        hdr.resize(sizeof(struct psf2_header));
+        memcpy(hdr.data(), header.psf2.magic, 4);
+        psf_put_int(&hdr[4], header.psf2.version);
+        psf_put_int(&hdr[8], header.psf2.headersize);
+        psf_put_int(&hdr[12], header.psf2.flags);
+        psf_put_int(&hdr[16], header.psf2.length);
+        psf_put_int(&hdr[20], header.psf2.charsize);
+        psf_put_int(&hdr[24], header.psf2.height);
+        psf_put_int(&hdr[28], header.psf2.width);
+    }
+    return hdr;
+}
+
+/*
+ * Writes the modified glyphs into <filename> in place. Fails without
+ * touching the file if its header does not match the font or it is too
+ * short to hold all the glyphs.
+ */
+bool PSFFont::writeModifiedGlyphs(const char *filename) const
+{
+    int fd = open(filename, O_RDWR);
+    if (fd < 0) {
+        return false;
+    }
+
+    std::vector<unsigned char> hdr = headerBytes();
+    std::vector<unsigned char> disk(hdr.size());
+    size_t glyphsize = getGlyphSize();
+    off_t glyphsEnd = static_cast<off_t>(hdr.size() + glyphv.size() * glyphsize);
+    struct stat st;
+
+    if (fstat(fd, &st) < 0 || st.st_size < glyphsEnd
+            || pread(fd, disk.data(), disk.size(), 0) != static_cast<ssize_t>(disk.size())
+            || disk != hdr) {
+        close(fd);
+        return false;
+    }
+
+    std::vector<unsigned char> zero(glyphsize, 0);
+    for (size_t i = 0; i < glyphv.size(); ++i) {
+        const PSFGlyph& glyph = glyphv[i];
+        if (!glyph.isModified()) {
+            continue;
+        }
+        const unsigned char *gdata = glyph.data.empty() ? zero.data() : glyph.data.data();
+        if (!psf_pwrite_all(fd, gdata, glyphsize, static_cast<off_t>(hdr.size() + i * glyphsize))) {
+            perror(__func__);
+            close(fd);
+            return false;
+        }
+    }
+    bool ok = (fdatasync(fd) == 0);
+    if (close(fd) < 0) {
+        ok = false;
+    }
+    return ok;
+}
+
+bool PSFFont::saveChangesToFile(const char *filename) const
+{
+    if (!isLayoutModified() && writeModifiedGlyphs(filename)) {
+        return true;
+    }
+
+    // Full rewrite. The old file stays intact until the new one is on disk.
+    std::ostringstream out(std::ios::out | std::ios::binary);
+    if (!saveToFile(out)) {
+        return false;
+    }
+    std::string data = out.str();
+
+    // Replace the file a symlink points to, not the symlink
+    char *resolved = realpath(filename, nullptr);
+    std::string target = (resolved != nullptr) ? resolved : filename;
+    free(resolved);
+    std::string tmpname = target + ".tmp";
+    struct stat st;
+    bool exists = (stat(target.c_str(), &st) == 0);
+
+    int fd = open(tmpname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(__func__);
+        return false;
+    }
+    bool ok = psf_pwrite_all(fd, reinterpret_cast<const unsigned char *>(data.data()), data.size(), 0)
+              && (!exists || fchmod(fd, st.st_mode & 07777) == 0)
+              && fsync(fd) == 0;
+    if (close(fd) < 0) {
+        ok = false;
+    }
+    if (!ok || rename(tmpname.c_str(), target.c_str()) != 0) {
+        perror(__func__);
+        unlink(tmpname.c_str());
+        return false;
+    }
+
+    // Make the rename itself durable
+    size_t slash = target.find_last_of('/');
+    std::string dir = (slash == std::string::npos) ? "." : (slash == 0) ? "/" : target.substr(0, slash);
+    int dirfd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirfd < 0 || (fsync(dirfd) < 0 && errno != EINVAL)) {
+        perror(__func__);
+        ok = false;
+    }
+    if (dirfd >= 0) {
+        close(dirfd);
+    }
+    return ok;
+}
+
+void PSFFont::markSaved(const PSFFont& saved)
+{
+    size_t n = std::min(glyphv.size(), saved.glyphv.size());
+    for (size_t i = 0; i < n; ++i) {
+        glyphv[i].saved_generation = saved.glyphv[i].generation;
+    }
+    saved_layout_generation = saved.layout_generation;
+}
+
+bool PSFFont::getChangesSince(const PSFFont& base, PSFFontChanges& changes) const
+{
+    if (version != base.version || getWidth() != base.getWidth() || getHeight() != base.getHeight()
+            || glyphv.size() < base.glyphv.size()) {
+        return false;
+    }
+    changes.layout.version = version;
+    changes.layout.header = header;
+    changes.layout.glyphv.clear();
+    changes.layout.layout_generation = layout_generation;
+    changes.layout.saved_layout_generation = saved_layout_generation;
+    changes.numGlyphs = getNumGlyphs();
+    changes.glyphs.clear();
+
+    // Unicode values are only compared if the unicode table changed
+    bool layoutChanged = (layout_generation != base.layout_generation);
+    for (unsigned int i = 0; i < glyphv.size(); ++i) {
+        const PSFGlyph& glyph = glyphv[i];
+        if (i >= base.glyphv.size() || glyph.generation != base.glyphv[i].generation
+                || (layoutChanged && glyph.unicode_vals != base.glyphv[i].unicode_vals)) {
+            changes.glyphs.emplace_back(i, glyph);
+        }
+    }
+    return true;
+}
+
+void PSFFont::applyChanges(PSFFontChanges&& changes)
+{
+    version = changes.layout.version;
+    header = changes.layout.header;
+    layout_generation = changes.layout.layout_generation;
+    saved_layout_generation = changes.layout.saved_layout_generation;
+    glyphv.resize(changes.numGlyphs);
+    for (std::pair<unsigned int, PSFGlyph>& change : changes.glyphs) {
+        glyphv[change.first] = std::move(change.second);
+    }
+    changes.glyphs.clear();
+    attachGlyphs();
+}
+
 void PSFFont::resizeGlyphVector(unsigned int num)
 {
     unsigned int ng = getNumGlyphs();
@@ -411,6 +691,7 @@ void PSFFont::resizeGlyphVector(unsigned int num)
 		unsigned int nng = num <= 256 ? 256 : 512;
 		if (nng > ng) {
             glyphv.resize(nng);
+            layout_generation++;
 			if (nng == 512) {
                 header.psf1.mode |= PSF1_MODE512;
             }
@@ -419,6 +700,7 @@ void PSFFont::resizeGlyphVector(unsigned int num)
 		if (num > ng) {
             glyphv.resize(num);
             header.psf2.length = num;
+            layout_generation++;
 		}
     }
 }
@@ -437,6 +719,7 @@ void PSFGlyph::init(PSFFont *font)
     this->font = font;
     data.clear();
     data.resize(font->getGlyphSize());
+    generation++;
 }
 
 bool PSFGlyph::setPixel(unsigned int x, unsigned int y, unsigned int val)
@@ -452,6 +735,7 @@ bool PSFGlyph::setPixel(unsigned int x, unsigned int y, unsigned int val)
 	} else {
         data[byte] &= ~mask;
 	}
+    generation++;
     return true;
 }
 
@@ -483,6 +767,7 @@ bool PSFGlyph::addUnicodeVal(unsigned int uni)
         return false;
 	}
     unicode_vals.push_back(uni);
+    font->layout_generation++;
     if (font->isVersion1()) {
         font->header.psf1.mode |= PSF1_MODEHASTAB;
 		if (uni == PSF1_STARTSEQ) {
@@ -494,3 +779,9 @@ bool PSFGlyph::addUnicodeVal(unsigned int uni)
 
     return true;
 }
+
+void PSFGlyph::clearUnicodeVals()
+{
+    unicode_vals.clear();
+    font->layout_generation++;
+}
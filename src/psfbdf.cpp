@@ -0,0 +1,399 @@
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "psfbdf.h"
+#include "psfparallel.h"
+
+namespace {
+
+// Minimum amount of glyph records decoded by one worker
+const size_t BDF_MIN_CHUNK = 512;
+
+struct BdfLine {
+    const char *begin;
+    const char *end;
+};
+
+struct BdfBox {
+    int w, h, x, y;
+};
+
+struct BdfGlyph {
+    int encoding = -1;
+    std::vector<unsigned char> data;
+};
+
+/*
+ * Line based tokenizer over an in-memory BDF file. Lines are returned
+ * without the trailing "\n" or "\r\n".
+ */
+class BdfTokenizer {
+public:
+    BdfTokenizer(const char *begin, const char *end): ptr(begin), end(end) {}
+
+    bool nextLine(BdfLine& line) {
+        if (ptr >= end) {
+            return false;
+        }
+        const char *nl = static_cast<const char *>(memchr(ptr, '\n', static_cast<size_t>(end - ptr)));
+        line.begin = ptr;
+        line.end = (nl != nullptr) ? nl : end;
+        if (line.end > line.begin && line.end[-1] == '\r') {
+            line.end--;
+        }
+        ptr = (nl != nullptr) ? nl + 1 : end;
+        return true;
+    }
+
+    const char *position() const { return ptr; }
+
+private:
+    const char *ptr;
+    const char *end;
+};
+
+bool isKeyword(const BdfLine& line, const char *kw, const char **rest = nullptr)
+{
+    size_t n = strlen(kw);
+    if (static_cast<size_t>(line.end - line.begin) < n || memcmp(line.begin, kw, n) != 0) {
+        return false;
+    }
+    const char *p = line.begin + n;
+    if (p != line.end && *p != ' ' && *p != '\t') {
+        return false;
+    }
+    if (rest != nullptr) {
+        *rest = p;
+    }
+    return true;
+}
+
+bool parseInt(const char *&p, const char *end, int& val)
+{
+    while (p < end && (*p == ' ' || *p == '\t')) { ++p; }
+
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        neg = (*p == '-');
+        ++p;
+    }
+    if (p >= end || *p < '0' || *p > '9') {
+        return false;
+    }
+    long v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p - '0');
+        if (v > INT_MAX) { return false; }
+        ++p;
+    }
+    val = static_cast<int>(neg ? -v : v);
+    return true;
+}
+
+bool parseBox(const char *p, const char *end, BdfBox& box)
+{
+    return parseInt(p, end, box.w) && parseInt(p, end, box.h)
+            && parseInt(p, end, box.x) && parseInt(p, end, box.y)
+            && box.w >= 0 && box.h >= 0;
+}
+
+inline int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9') { return c - '0'; }
+    if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+    if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+    return -1;
+}
+
+/*
+ * ORs the first <nbits> bits of <src> into the row <dst>, which is
+ * <dstBits> pixels wide, starting at pixel <dstx>. Both rows store the
+ * leftmost pixel in the most significant bit. Bits falling outside of
+ * the destination row are dropped.
+ */
+void orRowBits(unsigned char *dst, unsigned dstBits, int dstx, const unsigned char *src, unsigned nbits)
+{
+    unsigned dstBytes = (dstBits + 7) >> 3;
+    unsigned srcBytes = (nbits + 7) >> 3;
+
+    for (unsigned i = 0; i < srcBytes; ++i) {
+        unsigned v = src[i];
+        if (i == srcBytes - 1 && (nbits & 7) != 0) {
+            v &= (0xFF00u >> (nbits & 7)) & 0xFF;
+        }
+        if (v == 0) {
+            continue;
+        }
+        int pos = dstx + static_cast<int>(i * 8);
+        if (pos < 0) {
+            if (pos <= -8) { continue; }
+            v = (v << -pos) & 0xFF;
+            pos = 0;
+        }
+        unsigned byte = static_cast<unsigned>(pos) >> 3;
+        unsigned shift = static_cast<unsigned>(pos) & 7;
+        if (byte < dstBytes) {
+            dst[byte] |= static_cast<unsigned char>(v >> shift);
+        }
+        if (shift != 0 && byte + 1 < dstBytes) {
+            dst[byte + 1] |= static_cast<unsigned char>((v << (8 - shift)) & 0xFF);
+        }
+    }
+    if ((dstBits & 7) != 0) {
+        dst[dstBytes - 1] &= static_cast<unsigned char>((0xFF00u >> (dstBits & 7)) & 0xFF);
+    }
+}
+
+/*
+ * Decodes one STARTCHAR ... ENDCHAR record into a bitmap of the size of
+ * the font bounding box.
+ */
+bool decodeGlyph(const char *begin, const char *end, const BdfBox& fbb, BdfGlyph& glyph)
+{
+    unsigned rowBytes = (static_cast<unsigned>(fbb.w) + 7) >> 3;
+    BdfTokenizer tok(begin, end);
+    BdfLine line;
+    BdfBox bbx = fbb;
+    const char *rest;
+
+    glyph.data.assign(rowBytes * static_cast<unsigned>(fbb.h), 0);
+
+    while (tok.nextLine(line)) {
+        if (isKeyword(line, "ENCODING", &rest)) {
+            if (!parseInt(rest, line.end, glyph.encoding)) { return false; }
+        } else if (isKeyword(line, "BBX", &rest)) {
+            if (!parseBox(rest, line.end, bbx)) { return false; }
+        } else if (isKeyword(line, "BITMAP")) {
+            unsigned srcBytes = (static_cast<unsigned>(bbx.w) + 7) >> 3;
+            std::vector<unsigned char> src(srcBytes);
+            int dstx = bbx.x - fbb.x;
+            int dsty = (fbb.y + fbb.h) - (bbx.y + bbx.h);
+
+            for (int r = 0; r < bbx.h; ++r) {
+                if (!tok.nextLine(line)) { return false; }
+
+                std::fill(src.begin(), src.end(), 0);
+                const char *p = line.begin;
+                for (unsigned b = 0; b < srcBytes && p + 1 < line.end; ++b, p += 2) {
+                    int hi = hexDigit(p[0]), lo = hexDigit(p[1]);
+                    if (hi < 0 || lo < 0) { return false; }
+                    src[b] = static_cast<unsigned char>((hi << 4) | lo);
+                }
+                int y = dsty + r;
+                if (y < 0 || y >= fbb.h) {
+                    continue;
+                }
+                orRowBits(&glyph.data[static_cast<unsigned>(y) * rowBytes], static_cast<unsigned>(fbb.w),
+                          dstx, src.data(), static_cast<unsigned>(bbx.w));
+            }
+        } else if (isKeyword(line, "ENDCHAR")) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool readWholeFile(const std::string& filename, std::vector<char>& buf)
+{
+    std::ifstream in(filename, std::ios::in | std::ios::binary);
+    if (!in.is_open()) {
+        perror(__func__);
+        return false;
+    }
+    in.seekg(0, in.end);
+    std::streamoff length = in.tellg();
+    in.seekg(0, in.beg);
+    if (length < 0) {
+        return false;
+    }
+    buf.resize(static_cast<size_t>(length));
+    in.read(buf.data(), length);
+    return in.gcount() == length;
+}
+
+int glyphEncoding(const PSFFont& font, unsigned index)
+{
+    if (!font.hasUnicodeTable()) {
+        return static_cast<int>(index);
+    }
+    const std::vector<unsigned int>& uvals = font.getGlyph(index).getUnicodeValues();
+    if (uvals.empty() || uvals[0] == PSF1_STARTSEQ) {
+        return -1;
+    }
+    return static_cast<int>(uvals[0]);
+}
+
+}
+
+namespace PSF {
+
+bool loadFromBdf(PSFFont& font, const std::string& filename, PSFProgress *progress)
+{
+    std::vector<char> buf;
+    if (!readWholeFile(filename, buf)) {
+        return false;
+    }
+
+    BdfTokenizer tok(buf.data(), buf.data() + buf.size());
+    BdfLine line;
+    BdfBox fbb = {0, 0, 0, 0};
+    bool hasBox = false;
+    const char *rest;
+
+    if (!tok.nextLine(line) || !isKeyword(line, "STARTFONT")) {
+        std::cerr << "'" << filename << "' is not a BDF file\n";
+        return false;
+    }
+
+    // Header, up to the first glyph record
+    std::vector<const char *> records;
+    const char *fontEnd = buf.data() + buf.size();
+    while (true) {
+        const char *lineStart = tok.position();
+        if (!tok.nextLine(line)) {
+            break;
+        }
+        if (isKeyword(line, "FONTBOUNDINGBOX", &rest)) {
+            hasBox = parseBox(rest, line.end, fbb);
+        } else if (isKeyword(line, "STARTCHAR")) {
+            records.push_back(lineStart);
+            break;
+        }
+    }
+    if (!hasBox || fbb.w == 0 || fbb.h == 0) {
+        std::cerr << "Missing or invalid FONTBOUNDINGBOX in '" << filename << "'\n";
+        return false;
+    }
+
+    // Find where every glyph record starts
+    while (true) {
+        const char *lineStart = tok.position();
+        if (!tok.nextLine(line)) {
+            break;
+        }
+        if (line.begin == line.end || (*line.begin != 'S' && *line.begin != 'E')) {
+            continue;
+        }
+        if (isKeyword(line, "STARTCHAR")) {
+            records.push_back(lineStart);
+        } else if (isKeyword(line, "ENDFONT")) {
+            fontEnd = lineStart;
+            break;
+        }
+    }
+    if (records.empty()) {
+        std::cerr << "No glyphs found in '" << filename << "'\n";
+        return false;
+    }
+
+    // Decode the glyph records in parallel
+    size_t count = records.size();
+    std::vector<BdfGlyph> glyphs(count);
+    std::vector<size_t> failed(chunkCount(count, BDF_MIN_CHUNK), count);
+
+    if (progress != nullptr) {
+        progress->setTotal(count);
+    }
+    parallelChunks(count, BDF_MIN_CHUNK, [&](unsigned chunk, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (progress != nullptr) {
+                if (progress->isCanceled()) { return; }
+                progress->advance();
+            }
+            const char *recEnd = (i + 1 < count) ? records[i + 1] : fontEnd;
+            if (!decodeGlyph(records[i], recEnd, fbb, glyphs[i])) {
+                failed[chunk] = i;
+                return;
+            }
+        }
+    });
+    if (progress != nullptr && progress->isCanceled()) {
+        return false;
+    }
+    for (size_t f : failed) {
+        if (f != count) {
+            std::cerr << "Invalid glyph record " << f << " in '" << filename << "'\n";
+            return false;
+        }
+    }
+
+    font.init(PSFVersion::V2, static_cast<unsigned>(fbb.w), static_cast<unsigned>(fbb.h));
+    font.addGlyph(static_cast<unsigned>(count - 1));
+    for (unsigned i = 0; i < count; ++i) {
+        PSFGlyph& glyph = font.getGlyph(i);
+        glyph.init(&font, std::move(glyphs[i].data));
+        if (glyphs[i].encoding >= 0) {
+            glyph.addUnicodeVal(static_cast<unsigned>(glyphs[i].encoding));
+        }
+    }
+    return true;
+}
+
+bool saveToBdf(const PSFFont& font, const std::string& filename)
+{
+    std::ofstream out(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    static const char hexdig[] = "0123456789ABCDEF";
+    unsigned w = font.getWidth();
+    unsigned h = font.getHeight();
+    unsigned rowBytes = (w + 7) >> 3;
+    unsigned count = font.getNumGlyphs();
+    char tmp[128];
+
+    snprintf(tmp, sizeof(tmp), "STARTFONT 2.1\nFONT -PSFEditor-Fixed-Medium-R-Normal--%u-%u-75-75-C-%u-ISO10646-1\n",
+             h, h * 10, w * 10);
+    out << tmp;
+    snprintf(tmp, sizeof(tmp), "SIZE %u 75 75\nFONTBOUNDINGBOX %u %u 0 0\n", h, w, h);
+    out << tmp;
+    snprintf(tmp, sizeof(tmp), "STARTPROPERTIES 2\nFONT_ASCENT %u\nFONT_DESCENT 0\nENDPROPERTIES\nCHARS %u\n", h, count);
+    out << tmp;
+
+    // Format the glyph records in parallel, then write them in order
+    std::vector<std::string> chunks(chunkCount(count, BDF_MIN_CHUNK));
+    parallelChunks(count, BDF_MIN_CHUNK, [&](unsigned chunk, size_t begin, size_t end) {
+        std::string& s = chunks[chunk];
+        char line[128];
+
+        for (size_t i = begin; i < end; ++i) {
+            unsigned index = static_cast<unsigned>(i);
+            int enc = glyphEncoding(font, index);
+
+            if (enc >= 0) {
+                snprintf(line, sizeof(line), "STARTCHAR U+%04X\nENCODING %d\n", static_cast<unsigned>(enc), enc);
+            } else {
+                snprintf(line, sizeof(line), "STARTCHAR glyph%u\nENCODING -1\n", index);
+            }
+            s += line;
+            snprintf(line, sizeof(line), "SWIDTH %u 0\nDWIDTH %u 0\nBBX %u %u 0 0\nBITMAP\n", (w * 1000) / h, w, w, h);
+            s += line;
+
+            const std::vector<unsigned char>& data = font.getGlyph(index).getData();
+            for (unsigned y = 0; y < h; ++y) {
+                for (unsigned b = 0; b < rowBytes; ++b) {
+                    unsigned char v = data.empty() ? 0 : data[y * rowBytes + b];
+                    s += hexdig[v >> 4];
+                    s += hexdig[v & 0xF];
+                }
+                s += '\n';
+            }
+            s += "ENDCHAR\n";
+        }
+    });
+    for (const std::string& s : chunks) {
+        out.write(s.data(), static_cast<std::streamsize>(s.size()));
+    }
+    out << "ENDFONT\n";
+    out.close();
+
+    return !out.fail();
+}
+
+}
@@ -0,0 +1,257 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "psfcompiled.h"
+
+namespace {
+
+inline size_t alignUp(size_t v, size_t a)
+{
+    return (v + a - 1) & ~(a - 1);
+}
+
+struct SequenceEntry {
+    std::vector<uint32_t> values;
+    uint32_t glyph;
+};
+
+bool sequenceLess(const uint32_t *a, size_t alen, const uint32_t *b, size_t blen)
+{
+    return std::lexicographical_compare(a, a + alen, b, b + blen);
+}
+
+}
+
+bool PSFCompiledFont::open(const char *filename)
+{
+    close();
+    if (!file.open(filename)) {
+        return false;
+    }
+    const unsigned char *p = file.data();
+    size_t size = file.size();
+    const PSFCompiledHeader *h = reinterpret_cast<const PSFCompiledHeader *>(p);
+
+    if (size < sizeof(PSFCompiledHeader) || memcmp(h->magic, PSFC_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s: invalid magic number\n", __func__);
+        close();
+        return false;
+    }
+    if (h->version != PSFC_VERSION || h->byteOrder != PSFC_BYTE_ORDER) {
+        fprintf(stderr, "%s: unsupported version or byte order\n", __func__);
+        close();
+        return false;
+    }
+
+    size_t glyphEnd = h->glyphOffset + static_cast<size_t>(h->numGlyphs) * h->charsize;
+    size_t cpEnd = h->cpOffset + static_cast<size_t>(h->numCodepoints) * sizeof(PSFCompiledCodepoint);
+    size_t seqEnd = h->seqOffset + static_cast<size_t>(h->numSequences) * sizeof(PSFCompiledSequence)
+                    + static_cast<size_t>(h->seqPoolSize) * sizeof(uint32_t);
+
+    if (h->fileSize != size || h->rowBytes != (h->width + 7) / 8 || h->charsize != h->rowBytes * h->height
+            || (h->glyphOffset % PSFC_ALIGN) != 0 || (h->cpOffset % 4) != 0 || (h->seqOffset % 4) != 0
+            || glyphEnd > size || cpEnd > size || seqEnd > size) {
+        fprintf(stderr, "%s: corrupted compiled font\n", __func__);
+        close();
+        return false;
+    }
+
+    hdr = h;
+    base = p;
+    cps = reinterpret_cast<const PSFCompiledCodepoint *>(p + h->cpOffset);
+    seqs = reinterpret_cast<const PSFCompiledSequence *>(p + h->seqOffset);
+    pool = reinterpret_cast<const uint32_t *>(p + h->seqOffset + h->numSequences * sizeof(PSFCompiledSequence));
+    return true;
+}
+
+void PSFCompiledFont::close()
+{
+    file.close();
+    hdr = nullptr;
+    base = nullptr;
+    cps = nullptr;
+    seqs = nullptr;
+    pool = nullptr;
+}
+
+long PSFCompiledFont::findGlyph(uint32_t codepoint) const
+{
+    const PSFCompiledCodepoint *end = cps + hdr->numCodepoints;
+    const PSFCompiledCodepoint *it = std::lower_bound(cps, end, codepoint,
+                                                      [](const PSFCompiledCodepoint& e, uint32_t cp) {
+        return e.codepoint < cp;
+    });
+    if (it == end || it->codepoint != codepoint || it->glyph >= hdr->numGlyphs) {
+        return -1;
+    }
+    return it->glyph;
+}
+
+long PSFCompiledFont::findSequence(const uint32_t *seq, size_t len) const
+{
+    size_t lo = 0, hi = hdr->numSequences;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        const PSFCompiledSequence& e = seqs[mid];
+        if (e.offset > hdr->seqPoolSize || e.length > hdr->seqPoolSize - e.offset) {
+            return -1;
+        }
+        const uint32_t *s = pool + e.offset;
+        if (sequenceLess(s, e.length, seq, len)) {
+            lo = mid + 1;
+        } else if (sequenceLess(seq, len, s, e.length)) {
+            hi = mid;
+        } else {
+            return (e.glyph < hdr->numGlyphs) ? static_cast<long>(e.glyph) : -1;
+        }
+    }
+    return -1;
+}
+
+namespace PSF {
+
+bool saveToCompiled(const PSFFont& font, const std::string& filename)
+{
+    std::ofstream out(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    unsigned int numglyphs = font.getNumGlyphs();
+    unsigned int charsize = font.getGlyphSize();
+    std::vector<PSFCompiledCodepoint> cpv;
+    std::vector<SequenceEntry> seqv;
+
+    // Split every glyph's unicode values into single code points and sequences
+    for (unsigned i = 0; i < numglyphs && font.hasUnicodeTable(); ++i) {
+        const std::vector<unsigned int>& vals = font.getGlyph(i).getUnicodeValues();
+        size_t k = 0;
+        for (; k < vals.size() && vals[k] != PSF1_STARTSEQ; ++k) {
+            cpv.push_back({ vals[k], i });
+        }
+        while (k < vals.size()) {
+            SequenceEntry e;
+            e.glyph = i;
+            for (++k; k < vals.size() && vals[k] != PSF1_STARTSEQ; ++k) {
+                e.values.push_back(vals[k]);
+            }
+            if (!e.values.empty()) {
+                seqv.push_back(std::move(e));
+            }
+        }
+    }
+    std::stable_sort(cpv.begin(), cpv.end(), [](const PSFCompiledCodepoint& a, const PSFCompiledCodepoint& b) {
+        return a.codepoint < b.codepoint;
+    });
+    std::stable_sort(seqv.begin(), seqv.end(), [](const SequenceEntry& a, const SequenceEntry& b) {
+        return sequenceLess(a.values.data(), a.values.size(), b.values.data(), b.values.size());
+    });
+
+    size_t poolSize = 0;
+    for (const SequenceEntry& e : seqv) {
+        poolSize += e.values.size();
+    }
+
+    PSFCompiledHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PSFC_MAGIC, 4);
+    h.version = PSFC_VERSION;
+    h.byteOrder = PSFC_BYTE_ORDER;
+    h.flags = font.hasUnicodeTable() ? PSFC_HAS_UNICODE_TABLE : 0;
+    h.width = font.getWidth();
+    h.height = font.getHeight();
+    h.rowBytes = (h.width + 7) / 8;
+    h.charsize = charsize;
+    h.numGlyphs = numglyphs;
+    h.numCodepoints = static_cast<uint32_t>(cpv.size());
+    h.numSequences = static_cast<uint32_t>(seqv.size());
+    h.seqPoolSize = static_cast<uint32_t>(poolSize);
+
+    size_t glyphOffset = alignUp(sizeof(h), PSFC_ALIGN);
+    size_t cpOffset = alignUp(glyphOffset + static_cast<size_t>(numglyphs) * charsize, 8);
+    size_t seqOffset = alignUp(cpOffset + cpv.size() * sizeof(PSFCompiledCodepoint), 8);
+    size_t fileSize = seqOffset + seqv.size() * sizeof(PSFCompiledSequence) + poolSize * sizeof(uint32_t);
+    if (fileSize > UINT32_MAX) {
+        std::cerr << "Font too big for a compiled font blob\n";
+        return false;
+    }
+    h.glyphOffset = static_cast<uint32_t>(glyphOffset);
+    h.cpOffset = static_cast<uint32_t>(cpOffset);
+    h.seqOffset = static_cast<uint32_t>(seqOffset);
+    h.fileSize = static_cast<uint32_t>(fileSize);
+
+    std::vector<unsigned char> blob(fileSize, 0);
+    memcpy(blob.data(), &h, sizeof(h));
+    for (unsigned i = 0; i < numglyphs; ++i) {
+        const std::vector<unsigned char>& data = font.getGlyph(i).getData();
+        if (!data.empty()) {
+            memcpy(&blob[glyphOffset + static_cast<size_t>(i) * charsize], data.data(), charsize);
+        }
+    }
+    if (!cpv.empty()) {
+        memcpy(&blob[cpOffset], cpv.data(), cpv.size() * sizeof(PSFCompiledCodepoint));
+    }
+
+    unsigned char *seqp = &blob[seqOffset];
+    unsigned char *poolp = seqp + seqv.size() * sizeof(PSFCompiledSequence);
+    uint32_t offset = 0;
+    for (const SequenceEntry& e : seqv) {
+        PSFCompiledSequence s = { offset, static_cast<uint32_t>(e.values.size()), e.glyph };
+        memcpy(seqp, &s, sizeof(s));
+        seqp += sizeof(s);
+        memcpy(poolp + offset * sizeof(uint32_t), e.values.data(), e.values.size() * sizeof(uint32_t));
+        offset += s.length;
+    }
+
+    out.write(reinterpret_cast<const char *>(blob.data()), static_cast<std::streamsize>(blob.size()));
+    out.close();
+
+    return !out.fail();
+}
+
+bool loadFromCompiled(PSFFont& font, const std::string& filename)
+{
+    PSFCompiledFont cf;
+    if (!cf.open(filename.c_str())) {
+        return false;
+    }
+
+    unsigned int numglyphs = cf.getNumGlyphs();
+    unsigned int charsize = cf.getGlyphSize();
+    font.init(PSFVersion::V2, cf.getWidth(), cf.getHeight());
+    if (numglyphs == 0) {
+        return true;
+    }
+    font.addGlyph(numglyphs - 1);
+    for (unsigned i = 0; i < numglyphs; ++i) {
+        const unsigned char *p = cf.getGlyph(i);
+        font.getGlyph(i).init(&font, std::vector<unsigned char>(p, p + charsize));
+    }
+
+    // Code points first, then sequences, both in table order
+    const PSFCompiledHeader& h = cf.header();
+    for (unsigned i = 0; i < h.numCodepoints; ++i) {
+        const PSFCompiledCodepoint& e = cf.codepoints()[i];
+        if (e.glyph < numglyphs) {
+            font.getGlyph(e.glyph).addUnicodeVal(e.codepoint);
+        }
+    }
+    for (unsigned i = 0; i < h.numSequences; ++i) {
+        const PSFCompiledSequence& e = cf.sequences()[i];
+        if (e.glyph >= numglyphs || e.offset > h.seqPoolSize || e.length > h.seqPoolSize - e.offset) {
+            continue;
+        }
+        PSFGlyph& glyph = font.getGlyph(e.glyph);
+        glyph.addUnicodeVal(PSF1_STARTSEQ);
+        for (unsigned k = 0; k < e.length; ++k) {
+            glyph.addUnicodeVal(cf.sequencePool()[e.offset + k]);
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,397 @@
+#include <cstring>
+#include <algorithm>
+#include "psfconsole.h"
+#include "mini_utf8.h"
+
+namespace {
+
+/*
+ * Pixel masks of every glyph byte: expandMask()[b][k] is all ones if pixel
+ * k (from the left) of byte b is set. A pixel is then bg ^ ((fg ^ bg) & mask),
+ * without branches, and a whole byte of the row is expanded at once.
+ */
+typedef uint32_t ExpandRow[8];
+
+const ExpandRow *expandMask()
+{
+    static const std::vector<uint32_t> lut = [] {
+        std::vector<uint32_t> v(256 * 8);
+        for (unsigned b = 0; b < 256; ++b) {
+            for (unsigned k = 0; k < 8; ++k) {
+                v[b * 8 + k] = ((b >> (7 - k)) & 1u) ? 0xFFFFFFFFu : 0;
+            }
+        }
+        return v;
+    }();
+    return reinterpret_cast<const ExpandRow *>(lut.data());
+}
+
+/*
+ * Draws one glyph row of <width> pixels.
+ */
+inline void expandRow(const ExpandRow *lut, const unsigned char *src, unsigned width,
+                      uint32_t bg, uint32_t diff, uint32_t *dst)
+{
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const uint32_t *m = lut[*src++];
+        for (unsigned k = 0; k < 8; ++k) {
+            dst[x + k] = bg ^ (diff & m[k]);
+        }
+    }
+    if (x < width) {
+        const uint32_t *m = lut[*src];
+        for (unsigned k = 0; x + k < width; ++k) {
+            dst[x + k] = bg ^ (diff & m[k]);
+        }
+    }
+}
+
+/*
+ * Draws one glyph row of <width> pixels stretched to twice the width.
+ */
+inline void expandRowDoubled(const ExpandRow *lut, const unsigned char *src, unsigned width,
+                             uint32_t bg, uint32_t diff, uint32_t *dst)
+{
+    for (unsigned x = 0; x < width; x += 8) {
+        const uint32_t *m = lut[*src++];
+        for (unsigned k = 0; k < 8 && x + k < width; ++k) {
+            uint32_t px = bg ^ (diff & m[k]);
+            dst[2 * (x + k)] = px;
+            dst[2 * (x + k) + 1] = px;
+        }
+    }
+}
+
+/*
+ * Double width ranges (East Asian Wide and Fullwidth), sorted
+ */
+const uint32_t WIDE_RANGES[][2] = {
+    { 0x1100, 0x115F },   // Hangul Jamo initials
+    { 0x2E80, 0x303E },   // CJK radicals, Kangxi, CJK symbols and punctuation
+    { 0x3041, 0x33FF },   // Hiragana, Katakana, Bopomofo, CJK compatibility
+    { 0x3400, 0x4DBF },   // CJK extension A
+    { 0x4E00, 0x9FFF },   // CJK unified ideographs
+    { 0xA000, 0xA4CF },   // Yi
+    { 0xAC00, 0xD7A3 },   // Hangul syllables
+    { 0xF900, 0xFAFF },   // CJK compatibility ideographs
+    { 0xFE30, 0xFE4F },   // CJK compatibility forms
+    { 0xFF00, 0xFF60 },   // Fullwidth forms
+    { 0xFFE0, 0xFFE6 },   // Fullwidth signs
+    { 0x1F300, 0x1F64F }, // Pictographs and emoticons
+    { 0x1F900, 0x1F9FF }, // Supplemental pictographs
+    { 0x20000, 0x2FFFD }, // CJK extensions B to F
+    { 0x30000, 0x3FFFD }  // CJK extension G
+};
+
+// ANSI color order with the VGA palette values
+const uint32_t VGA_PALETTE[16] = {
+    0x000000, 0xAA0000, 0x00AA00, 0xAA5500, 0x0000AA, 0xAA00AA, 0x00AAAA, 0xAAAAAA,
+    0x555555, 0xFF5555, 0x55FF55, 0xFFFF55, 0x5555FF, 0xFF55FF, 0x55FFFF, 0xFFFFFF
+};
+
+inline bool sameCell(const PSFCell& a, const PSFCell& b)
+{
+    return a.codepoint == b.codepoint && a.glyph == b.glyph && a.fg == b.fg && a.bg == b.bg && a.flags == b.flags;
+}
+
+}
+
+void PSFConsole::GlyphSet::load(const PSFFont& font)
+{
+    width = font.getWidth();
+    rowBytes = (width + 7) >> 3;
+    glyphSize = rowBytes * font.getHeight();
+    numGlyphs = font.getNumGlyphs();
+    byIndex = !font.hasUnicodeTable();
+
+    // One more, empty, glyph for blanks in fonts without a space
+    bitmaps.assign(static_cast<size_t>(numGlyphs + 1) * glyphSize, 0);
+    for (unsigned i = 0; i < numGlyphs; ++i) {
+        const std::vector<unsigned char>& data = font.getGlyph(i).getData();
+        memcpy(&bitmaps[static_cast<size_t>(i) * glyphSize], data.data(), std::min<size_t>(data.size(), glyphSize));
+    }
+
+    map.clear();
+    for (unsigned i = 0; i < numGlyphs && !byIndex; ++i) {
+        const std::vector<unsigned int>& vals = font.getGlyph(i).getUnicodeValues();
+        for (size_t k = 0; k < vals.size() && vals[k] != PSF1_STARTSEQ; ++k) {
+            map.push_back({ vals[k], i });
+        }
+    }
+    // The first glyph of a code point wins
+    std::sort(map.begin(), map.end());
+    map.erase(std::unique(map.begin(), map.end(),
+                          [](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b) {
+                              return a.first == b.first;
+                          }), map.end());
+}
+
+long PSFConsole::GlyphSet::find(uint32_t codepoint) const
+{
+    if (byIndex) {
+        return (codepoint < numGlyphs) ? static_cast<long>(codepoint) : -1;
+    }
+    auto it = std::lower_bound(map.begin(), map.end(), std::make_pair(codepoint, 0u));
+    return (it != map.end() && it->first == codepoint) ? static_cast<long>(it->second) : -1;
+}
+
+PSFConsole::PSFConsole(const PSFFont& font, unsigned columns, unsigned rows, const PSFFont *wideFont) :
+    cols(columns),
+    nrows(rows),
+    cellW(font.getWidth()),
+    cellH(font.getHeight()),
+    dirtyRows(0),
+    pendingScroll(0),
+    fullRedraw(true)
+{
+    narrow.load(font);
+    if (wideFont != nullptr && wideFont->getWidth() == 2 * cellW && wideFont->getHeight() == cellH) {
+        wide.load(*wideFont);
+    }
+
+    long g = narrow.find(' ');
+    blankGlyph = (g >= 0) ? static_cast<uint32_t>(g) : narrow.numGlyphs;
+    g = narrow.find(0xFFFD);
+    if (g < 0) {
+        g = narrow.find('?');
+    }
+    fallback = (g >= 0) ? static_cast<uint32_t>(g) : narrow.numGlyphs;
+
+    for (unsigned i = 0; i < 16; ++i) {
+        palette[i] = VGA_PALETTE[i];
+    }
+    static const uint32_t levels[6] = { 0x00, 0x5F, 0x87, 0xAF, 0xD7, 0xFF };
+    for (unsigned i = 0; i < 216; ++i) {
+        palette[16 + i] = (levels[i / 36] << 16) | (levels[(i / 6) % 6] << 8) | levels[i % 6];
+    }
+    for (unsigned i = 0; i < 24; ++i) {
+        uint32_t v = 8 + 10 * i;
+        palette[232 + i] = (v << 16) | (v << 8) | v;
+    }
+
+    grid.assign(static_cast<size_t>(cols) * nrows, blankCell(7, 0));
+    dirty.assign(grid.size(), 0);
+    rowDirty.assign(nrows, 0);
+    drawList.reserve(cols);
+}
+
+bool PSFConsole::isWide(uint32_t codepoint)
+{
+    if (codepoint < WIDE_RANGES[0][0]) {
+        return false;
+    }
+    const size_t n = sizeof(WIDE_RANGES) / sizeof(WIDE_RANGES[0]);
+    const uint32_t (*r)[2] = std::upper_bound(WIDE_RANGES, WIDE_RANGES + n, codepoint,
+                                              [](uint32_t cp, const uint32_t (&range)[2]) { return cp < range[0]; });
+    return codepoint <= r[-1][1];
+}
+
+PSFCell PSFConsole::makeCell(uint32_t codepoint, uint8_t fg, uint8_t bg, bool doubleWidth) const
+{
+    PSFCell c{ codepoint, fallback, fg, bg, 0 };
+    if (doubleWidth) {
+        c.flags = PSF_CELL_WIDE;
+        long g = (wide.width != 0) ? wide.find(codepoint) : -1;
+        if (g >= 0) {
+            c.glyph = static_cast<uint32_t>(g);
+            c.flags |= PSF_CELL_WIDE_FONT;
+            return c;
+        }
+    }
+    long g = narrow.find(codepoint);
+    if (g >= 0) {
+        c.glyph = static_cast<uint32_t>(g);
+    }
+    return c;
+}
+
+unsigned PSFConsole::setCell(unsigned x, unsigned y, uint32_t codepoint, uint8_t fg, uint8_t bg)
+{
+    if (x >= cols || y >= nrows) {
+        return 0;
+    }
+    bool w = isWide(codepoint);
+    if (w && x + 1 >= cols) {
+        codepoint = 0xFFFD;
+        w = false;
+    }
+
+    PSFCell c = makeCell(codepoint, fg, bg, w);
+    store(x, y, c);
+    if (!w) {
+        return 1;
+    }
+    c.flags = PSF_CELL_WIDE_TRAIL;
+    store(x + 1, y, c);
+    return 2;
+}
+
+unsigned PSFConsole::putText(unsigned x, unsigned y, const char *text, uint8_t fg, uint8_t bg)
+{
+    if (y >= nrows) {
+        return x;
+    }
+    const char *p = text;
+    while (*p != 0 && x < cols) {
+        int cp = mini_utf8_decode(&p);
+        if (cp < 0) {
+            cp = 0xFFFD;
+            p++;
+        }
+        x += setCell(x, y, static_cast<uint32_t>(cp), fg, bg);
+    }
+    return x;
+}
+
+/*
+ * Stores <c> at <x>, <y>. Overwriting one half of a double width character
+ * turns the other half into a blank.
+ */
+void PSFConsole::store(unsigned x, unsigned y, const PSFCell& c)
+{
+    const PSFCell& old = grid[static_cast<size_t>(y) * cols + x];
+    if ((old.flags & PSF_CELL_WIDE_TRAIL) && !(c.flags & PSF_CELL_WIDE_TRAIL) && x > 0) {
+        const PSFCell& lead = grid[static_cast<size_t>(y) * cols + x - 1];
+        assign(x - 1, y, blankCell(lead.fg, lead.bg));
+    }
+    if ((old.flags & PSF_CELL_WIDE) && x + 1 < cols) {
+        assign(x + 1, y, blankCell(old.fg, old.bg));
+    }
+    assign(x, y, c);
+}
+
+void PSFConsole::assign(unsigned x, unsigned y, const PSFCell& c)
+{
+    PSFCell& cell = grid[static_cast<size_t>(y) * cols + x];
+    if (sameCell(cell, c)) {
+        return;
+    }
+    cell = c;
+    markDirty(x, y);
+}
+
+void PSFConsole::markDirty(unsigned x, unsigned y)
+{
+    size_t i = static_cast<size_t>(y) * cols + x;
+    dirty[i] = 1;
+    // The second half of a double width character is drawn with the first
+    if ((grid[i].flags & PSF_CELL_WIDE_TRAIL) && x > 0) {
+        dirty[i - 1] = 1;
+    }
+    if (!rowDirty[y]) {
+        rowDirty[y] = 1;
+        dirtyRows++;
+    }
+}
+
+void PSFConsole::scrollUp(unsigned lines, uint8_t bg)
+{
+    if (lines == 0) {
+        return;
+    }
+    if (lines >= nrows) {
+        clear(bg);
+        return;
+    }
+
+    size_t moved = static_cast<size_t>(nrows - lines) * cols;
+    size_t shift = static_cast<size_t>(lines) * cols;
+    std::copy(grid.begin() + shift, grid.end(), grid.begin());
+    std::fill(grid.begin() + moved, grid.end(), blankCell(7, bg));
+    std::copy(dirty.begin() + shift, dirty.end(), dirty.begin());
+    std::fill(dirty.begin() + moved, dirty.end(), 1);
+    std::copy(rowDirty.begin() + lines, rowDirty.end(), rowDirty.begin());
+    std::fill(rowDirty.begin() + (nrows - lines), rowDirty.end(), 1);
+    dirtyRows = static_cast<unsigned>(std::count(rowDirty.begin(), rowDirty.end(), 1));
+
+    pendingScroll += lines;
+    if (pendingScroll >= nrows) {
+        fullRedraw = true;
+    }
+}
+
+void PSFConsole::clear(uint8_t bg)
+{
+    std::fill(grid.begin(), grid.end(), blankCell(7, bg));
+    fullRedraw = true;
+}
+
+void PSFConsole::setPalette(uint8_t index, uint32_t rgb)
+{
+    palette[index] = rgb & 0xFFFFFF;
+    fullRedraw = true;
+}
+
+void PSFConsole::drawCell(const PSFCell& c, unsigned y, uint32_t *dst) const
+{
+    const ExpandRow *lut = expandMask();
+    uint32_t bg = palette[c.bg];
+    uint32_t diff = palette[c.fg] ^ bg;
+
+    if (c.flags & PSF_CELL_WIDE_FONT) {
+        expandRow(lut, wide.glyph(c.glyph) + y * wide.rowBytes, wide.width, bg, diff, dst);
+    } else if (c.flags & PSF_CELL_WIDE) {
+        expandRowDoubled(lut, narrow.glyph(c.glyph) + y * narrow.rowBytes, narrow.width, bg, diff, dst);
+    } else {
+        expandRow(lut, narrow.glyph(c.glyph) + y * narrow.rowBytes, narrow.width, bg, diff, dst);
+    }
+}
+
+unsigned PSFConsole::render(uint32_t *pixels, size_t pitch)
+{
+    unsigned char *base = reinterpret_cast<unsigned char *>(pixels);
+    size_t lineBytes = static_cast<size_t>(pixelWidth()) * sizeof(uint32_t);
+
+    if (fullRedraw) {
+        std::fill(dirty.begin(), dirty.end(), 1);
+        std::fill(rowDirty.begin(), rowDirty.end(), 1);
+        dirtyRows = nrows;
+        pendingScroll = 0;
+        fullRedraw = false;
+    } else if (pendingScroll != 0) {
+        // The scanlines of the rows that were kept are moved, not drawn
+        size_t from = static_cast<size_t>(pendingScroll) * cellH;
+        size_t count = static_cast<size_t>(nrows - pendingScroll) * cellH;
+        if (pitch == lineBytes) {
+            memmove(base, base + from * pitch, count * pitch);
+        } else {
+            for (size_t y = 0; y < count; ++y) {
+                memmove(base + y * pitch, base + (y + from) * pitch, lineBytes);
+            }
+        }
+        pendingScroll = 0;
+    }
+    if (dirtyRows == 0) {
+        return 0;
+    }
+
+    unsigned drawn = 0;
+    for (unsigned r = 0; r < nrows; ++r) {
+        if (!rowDirty[r]) {
+            continue;
+        }
+        const PSFCell *row = &grid[static_cast<size_t>(r) * cols];
+        uint8_t *d = &dirty[static_cast<size_t>(r) * cols];
+
+        drawList.clear();
+        for (unsigned x = 0; x < cols; ++x) {
+            if (d[x] && !(row[x].flags & PSF_CELL_WIDE_TRAIL)) {
+                drawList.push_back(x);
+            }
+        }
+        memset(d, 0, cols);
+        rowDirty[r] = 0;
+
+        // Scanline by scanline, so the buffer is written front to back
+        for (unsigned y = 0; y < cellH; ++y) {
+            uint32_t *line = reinterpret_cast<uint32_t *>(base + (static_cast<size_t>(r) * cellH + y) * pitch);
+            for (unsigned x : drawList) {
+                drawCell(row[x], y, line + static_cast<size_t>(x) * cellW);
+            }
+        }
+        drawn += static_cast<unsigned>(drawList.size());
+    }
+    dirtyRows = 0;
+    return drawn;
+}
@@ -0,0 +1,128 @@
+#include <cstring>
+#include <algorithm>
+#include <bitset>
+#include <vector>
+#include "psfdiff.h"
+#include "psfparallel.h"
+
+namespace {
+
+// Minimum amount of glyphs compared by a worker
+const size_t DIFF_MIN_CHUNK_GLYPHS = 4096;
+
+inline unsigned popCount(uint64_t v)
+{
+    return static_cast<unsigned>(std::bitset<64>(v).count());
+}
+
+}
+
+namespace PSF {
+
+unsigned diffBitmaps(const unsigned char *a, const unsigned char *b, size_t size, unsigned char *mask)
+{
+    unsigned pixels = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= size; i += 8) {
+        uint64_t wa, wb;
+        memcpy(&wa, a + i, 8);
+        memcpy(&wb, b + i, 8);
+        uint64_t x = wa ^ wb;
+        if (mask != nullptr) {
+            memcpy(mask + i, &x, 8);
+        }
+        pixels += popCount(x);
+    }
+    for (; i < size; ++i) {
+        unsigned char x = a[i] ^ b[i];
+        if (mask != nullptr) {
+            mask[i] = x;
+        }
+        pixels += popCount(x);
+    }
+    return pixels;
+}
+
+unsigned diffGlyphs(const PSFGlyph& a, const PSFGlyph& b, std::vector<unsigned char> *mask)
+{
+    const std::vector<unsigned char>& da = a.getData();
+    const std::vector<unsigned char>& db = b.getData();
+    size_t size = std::max(da.size(), db.size());
+    std::vector<unsigned char> empty;
+    if (da.size() != size || db.size() != size) {
+        empty.resize(size, 0);
+    }
+    if (mask != nullptr) {
+        mask->resize(size);
+    }
+    return diffBitmaps(da.size() == size ? da.data() : empty.data(),
+                       db.size() == size ? db.data() : empty.data(),
+                       size, mask != nullptr ? mask->data() : nullptr);
+}
+
+bool diffFonts(const PSFFont& a, const PSFFont& b, PSFFontDiff& diff)
+{
+    if (a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight()) {
+        return false;
+    }
+
+    unsigned na = a.getNumGlyphs();
+    unsigned nb = b.getNumGlyphs();
+    unsigned common = std::min(na, nb);
+    size_t glyphsize = a.getGlyphSize();
+    std::vector<unsigned char> empty(glyphsize, 0);
+
+    auto bitmap = [&](const PSFGlyph& g) {
+        return g.getData().empty() ? empty.data() : g.getData().data();
+    };
+
+    unsigned nchunks = chunkCount(common, DIFF_MIN_CHUNK_GLYPHS);
+    std::vector<std::vector<PSFGlyphDiff>> found(nchunks);
+
+    parallelChunks(common, DIFF_MIN_CHUNK_GLYPHS, [&](unsigned chunk, size_t begin, size_t end) {
+        std::vector<PSFGlyphDiff>& out = found[chunk];
+        for (size_t i = begin; i < end; ++i) {
+            const PSFGlyph& ga = a.getGlyph(static_cast<unsigned>(i));
+            const PSFGlyph& gb = b.getGlyph(static_cast<unsigned>(i));
+            unsigned pixels = diffBitmaps(bitmap(ga), bitmap(gb), glyphsize);
+            bool unicode = ga.getUnicodeValues() != gb.getUnicodeValues();
+            if (pixels != 0 || unicode) {
+                out.push_back({static_cast<unsigned>(i), PSFDiffKind::Changed, pixels, unicode});
+            }
+        }
+    });
+
+    diff = PSFFontDiff();
+    for (const std::vector<PSFGlyphDiff>& chunk : found) {
+        diff.glyphs.insert(diff.glyphs.end(), chunk.begin(), chunk.end());
+    }
+
+    // Glyphs in only one of the fonts differ by all of their set pixels
+    const PSFFont& longer = (na > nb) ? a : b;
+    PSFDiffKind kind = (na > nb) ? PSFDiffKind::Removed : PSFDiffKind::Added;
+    for (unsigned i = common; i < longer.getNumGlyphs(); ++i) {
+        const PSFGlyph& g = longer.getGlyph(i);
+        unsigned pixels = diffBitmaps(bitmap(g), empty.data(), glyphsize);
+        diff.glyphs.push_back({i, kind, pixels, !g.getUnicodeValues().empty()});
+    }
+
+    for (const PSFGlyphDiff& g : diff.glyphs) {
+        switch (g.kind) {
+        case PSFDiffKind::Changed:
+            diff.changed++;
+            break;
+        case PSFDiffKind::Added:
+            diff.added++;
+            break;
+        case PSFDiffKind::Removed:
+            diff.removed++;
+            break;
+        }
+        diff.unicodeChanged += g.unicodeChanged ? 1 : 0;
+        diff.pixels += g.pixels;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,295 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "psfhex.h"
+#include "psfmmap.h"
+#include "psfparallel.h"
+
+namespace {
+
+// Unifont glyphs are always 16 rows high
+const unsigned HEX_ROWS = 16;
+
+// Minimum amount of bytes (when reading) or glyphs (when writing) per worker
+const size_t HEX_MIN_CHUNK_BYTES = 256 * 1024;
+const size_t HEX_MIN_CHUNK_GLYPHS = 1024;
+
+struct HexLine {
+    unsigned codepoint;
+    const unsigned char *bits;
+    unsigned ndigits;
+};
+
+struct HexChunkInfo {
+    size_t glyphs = 0;
+    unsigned maxWidth = 0;
+    bool ok = true;
+};
+
+inline int hexDigit(unsigned char c)
+{
+    if (c >= '0' && c <= '9') { return c - '0'; }
+    if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+    if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+    return -1;
+}
+
+/*
+ * Returns the start of the first line beginning at or after <pos>.
+ */
+const unsigned char *lineStartFrom(const unsigned char *buf, size_t size, size_t pos)
+{
+    if (pos == 0) {
+        return buf;
+    }
+    const void *nl = memchr(buf + pos - 1, '\n', size - (pos - 1));
+    return (nl != nullptr) ? static_cast<const unsigned char *>(nl) + 1 : buf + size;
+}
+
+/*
+ * Splits the line [begin, end) into code point and bitmap digits. Empty
+ * lines yield false with <empty> set.
+ */
+bool splitLine(const unsigned char *begin, const unsigned char *end, HexLine& line, bool& empty)
+{
+    if (end > begin && end[-1] == '\r') {
+        end--;
+    }
+    empty = (begin == end);
+    if (empty) {
+        return false;
+    }
+
+    unsigned cp = 0;
+    const unsigned char *p = begin;
+    for (; p < end && *p != ':'; ++p) {
+        int d = hexDigit(*p);
+        if (d < 0 || cp > 0x10FFFF) { return false; }
+        cp = (cp << 4) | static_cast<unsigned>(d);
+    }
+    if (p == begin || p == end || cp > 0x10FFFF) {
+        return false;
+    }
+    ++p;
+
+    unsigned ndigits = static_cast<unsigned>(end - p);
+    // Rows must be whole bytes: 16 rows of 2 * n digits
+    if (ndigits == 0 || (ndigits % (HEX_ROWS * 2)) != 0) {
+        return false;
+    }
+    line.codepoint = cp;
+    line.bits = p;
+    line.ndigits = ndigits;
+    return true;
+}
+
+template <typename Fn>
+bool forEachLine(const unsigned char *begin, const unsigned char *end, Fn fn)
+{
+    while (begin < end) {
+        const void *nl = memchr(begin, '\n', static_cast<size_t>(end - begin));
+        const unsigned char *le = (nl != nullptr) ? static_cast<const unsigned char *>(nl) : end;
+        if (!fn(begin, le)) {
+            return false;
+        }
+        begin = le + 1;
+    }
+    return true;
+}
+
+/*
+ * Returns true if the pixels right of column 8 are all unset.
+ */
+bool isNarrowGlyph(const std::vector<unsigned char>& data, unsigned rowBytes)
+{
+    for (unsigned y = 0; y < HEX_ROWS; ++y) {
+        for (unsigned b = 1; b < rowBytes; ++b) {
+            if (data[y * rowBytes + b] != 0) { return false; }
+        }
+    }
+    return true;
+}
+
+}
+
+namespace PSF {
+
+bool loadFromUnifontHex(PSFFont& font, const std::string& filename, PSFProgress *progress)
+{
+    PSFMappedFile file;
+    if (!file.open(filename.c_str())) {
+        return false;
+    }
+    const unsigned char *buf = file.data();
+    size_t size = file.size();
+    auto canceled = [progress]() { return progress != nullptr && progress->isCanceled(); };
+
+    if (progress != nullptr) {
+        progress->setTotal(2 * size);
+    }
+
+    // First pass: count the glyphs and find the widest one in every chunk
+    std::vector<HexChunkInfo> info(chunkCount(size, HEX_MIN_CHUNK_BYTES));
+    parallelChunks(size, HEX_MIN_CHUNK_BYTES, [&](unsigned chunk, size_t begin, size_t end) {
+        HexChunkInfo& ci = info[chunk];
+        ci.ok = forEachLine(lineStartFrom(buf, size, begin), lineStartFrom(buf, size, end),
+                            [&](const unsigned char *b, const unsigned char *e) {
+            HexLine line;
+            bool empty;
+            if (canceled()) {
+                return false;
+            }
+            if (!splitLine(b, e, line, empty)) {
+                return empty;
+            }
+            ci.glyphs++;
+            ci.maxWidth = std::max(ci.maxWidth, line.ndigits / HEX_ROWS * 4);
+            return true;
+        });
+        if (progress != nullptr) {
+            progress->advance(end - begin);
+        }
+    });
+    if (canceled()) {
+        return false;
+    }
+
+    size_t total = 0;
+    unsigned width = 0;
+    std::vector<size_t> firstGlyph(info.size());
+    for (size_t c = 0; c < info.size(); ++c) {
+        if (!info[c].ok) {
+            std::cerr << "Invalid line in '" << filename << "'\n";
+            return false;
+        }
+        firstGlyph[c] = total;
+        total += info[c].glyphs;
+        width = std::max(width, info[c].maxWidth);
+    }
+    if (total == 0) {
+        std::cerr << "No glyphs found in '" << filename << "'\n";
+        return false;
+    }
+
+    // Second pass: decode every chunk straight into its glyph slots
+    unsigned rowBytes = (width + 7) >> 3;
+    std::vector<std::vector<unsigned char>> bitmaps(total);
+    std::vector<unsigned> codepoints(total);
+    std::vector<char> chunkOk(info.size(), 1);
+
+    parallelChunks(size, HEX_MIN_CHUNK_BYTES, [&](unsigned chunk, size_t begin, size_t end) {
+        size_t index = firstGlyph[chunk];
+        chunkOk[chunk] = forEachLine(lineStartFrom(buf, size, begin), lineStartFrom(buf, size, end),
+                                     [&](const unsigned char *b, const unsigned char *e) {
+            HexLine line;
+            bool empty;
+            if (canceled()) {
+                return false;
+            }
+            if (!splitLine(b, e, line, empty)) {
+                return empty;
+            }
+            std::vector<unsigned char>& data = bitmaps[index];
+            data.assign(rowBytes * HEX_ROWS, 0);
+
+            unsigned srcBytes = line.ndigits / (HEX_ROWS * 2);
+            const unsigned char *p = line.bits;
+            for (unsigned y = 0; y < HEX_ROWS; ++y) {
+                unsigned char *row = &data[y * rowBytes];
+                for (unsigned x = 0; x < srcBytes; ++x, p += 2) {
+                    int hi = hexDigit(p[0]), lo = hexDigit(p[1]);
+                    if (hi < 0 || lo < 0) { return false; }
+                    row[x] = static_cast<unsigned char>((hi << 4) | lo);
+                }
+            }
+            codepoints[index] = line.codepoint;
+            index++;
+            return true;
+        });
+        if (progress != nullptr) {
+            progress->advance(end - begin);
+        }
+    });
+    if (canceled()) {
+        return false;
+    }
+    if (std::find(chunkOk.begin(), chunkOk.end(), 0) != chunkOk.end()) {
+        std::cerr << "Invalid hex digits in '" << filename << "'\n";
+        return false;
+    }
+
+    font.init(PSFVersion::V2, width, HEX_ROWS);
+    font.addGlyph(static_cast<unsigned>(total - 1));
+    for (unsigned i = 0; i < total; ++i) {
+        PSFGlyph& glyph = font.getGlyph(i);
+        glyph.init(&font, std::move(bitmaps[i]));
+        glyph.addUnicodeVal(codepoints[i]);
+    }
+    return true;
+}
+
+bool saveToUnifontHex(const PSFFont& font, const std::string& filename)
+{
+    if (font.getHeight() != HEX_ROWS) {
+        std::cerr << "The .hex format requires 16 pixel high glyphs\n";
+        return false;
+    }
+    std::ofstream out(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    // (code point, glyph index) pairs sorted by code point
+    std::vector<std::pair<unsigned, unsigned>> entries;
+    for (unsigned i = 0; i < font.getNumGlyphs(); ++i) {
+        if (!font.hasUnicodeTable()) {
+            entries.emplace_back(i, i);
+            continue;
+        }
+        for (unsigned v : font.getGlyph(i).getUnicodeValues()) {
+            if (v == PSF1_STARTSEQ) {
+                break;
+            }
+            entries.emplace_back(v, i);
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+
+    static const char hexdig[] = "0123456789ABCDEF";
+    unsigned rowBytes = (font.getWidth() + 7) >> 3;
+    std::vector<std::string> chunks(chunkCount(entries.size(), HEX_MIN_CHUNK_GLYPHS));
+
+    parallelChunks(entries.size(), HEX_MIN_CHUNK_GLYPHS, [&](unsigned chunk, size_t begin, size_t end) {
+        std::string& s = chunks[chunk];
+        char cpbuf[16];
+
+        for (size_t i = begin; i < end; ++i) {
+            const std::vector<unsigned char>& data = font.getGlyph(entries[i].second).getData();
+            unsigned outBytes = (data.empty() || isNarrowGlyph(data, rowBytes)) ? 1 : rowBytes;
+
+            snprintf(cpbuf, sizeof(cpbuf), entries[i].first > 0xFFFF ? "%06X:" : "%04X:", entries[i].first);
+            s += cpbuf;
+            for (unsigned y = 0; y < HEX_ROWS; ++y) {
+                for (unsigned b = 0; b < outBytes; ++b) {
+                    unsigned char v = data.empty() ? 0 : data[y * rowBytes + b];
+                    s += hexdig[v >> 4];
+                    s += hexdig[v & 0xF];
+                }
+            }
+            s += '\n';
+        }
+    });
+    for (const std::string& s : chunks) {
+        out.write(s.data(), static_cast<std::streamsize>(s.size()));
+    }
+    out.close();
+
+    return !out.fail();
+}
+
+}
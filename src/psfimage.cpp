@@ -0,0 +1,277 @@
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+#include "psfimage.h"
+#include "psfparallel.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define PSF_USE_SSE2
+#endif
+
+namespace {
+
+// Minimum amount of image rows converted by a worker
+const size_t GRAY_MIN_CHUNK_ROWS = 64;
+
+// BT.601 luma weights, scaled by 256
+const unsigned LUMA_R = 77;
+const unsigned LUMA_G = 150;
+const unsigned LUMA_B = 29;
+
+// Reverses the bits of a byte: movemask puts the leftmost pixel in bit 0
+const std::array<unsigned char, 256> BITREV = []() {
+    std::array<unsigned char, 256> t{};
+    for (unsigned i = 0; i < 256; ++i) {
+        unsigned r = 0;
+        for (unsigned b = 0; b < 8; ++b) {
+            r |= ((i >> b) & 1u) << (7 - b);
+        }
+        t[i] = static_cast<unsigned char>(r);
+    }
+    return t;
+}();
+
+// 8x8 Bayer matrix for ordered dithering
+const unsigned char BAYER8[8][8] = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 }
+};
+
+inline uchar lumaOf(QRgb p)
+{
+    if (qAlpha(p) < 128) {
+        return 0xFF;
+    }
+    return static_cast<uchar>((qRed(p) * LUMA_R + qGreen(p) * LUMA_G + qBlue(p) * LUMA_B) >> 8);
+}
+
+#ifdef PSF_USE_SSE2
+inline __m128i luma4(__m128i p)
+{
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    __m128i b = _mm_and_si128(p, byteMask);
+    __m128i g = _mm_and_si128(_mm_srli_epi32(p, 8), byteMask);
+    __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), byteMask);
+    __m128i a = _mm_srli_epi32(p, 24);
+
+    // Every product fits in the low 16 bits of its 32 bit lane
+    __m128i y = _mm_add_epi32(_mm_mullo_epi16(r, _mm_set1_epi32(LUMA_R)),
+                              _mm_mullo_epi16(g, _mm_set1_epi32(LUMA_G)));
+    y = _mm_srli_epi32(_mm_add_epi32(y, _mm_mullo_epi16(b, _mm_set1_epi32(LUMA_B))), 8);
+
+    __m128i transparent = _mm_cmplt_epi32(a, _mm_set1_epi32(128));
+    return _mm_or_si128(y, _mm_and_si128(transparent, byteMask));
+}
+#endif
+
+void grayRow(const QRgb *src, uchar *dst, int width)
+{
+    int x = 0;
+#ifdef PSF_USE_SSE2
+    for (; x + 16 <= width; x += 16) {
+        const __m128i *p = reinterpret_cast<const __m128i *>(src + x);
+        __m128i lo = _mm_packs_epi32(luma4(_mm_loadu_si128(p)), luma4(_mm_loadu_si128(p + 1)));
+        __m128i hi = _mm_packs_epi32(luma4(_mm_loadu_si128(p + 2)), luma4(_mm_loadu_si128(p + 3)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; x < width; ++x) {
+        dst[x] = lumaOf(src[x]);
+    }
+}
+
+}
+
+namespace PSF {
+
+QImage toGray8(const QImage& img)
+{
+    if (img.isNull()) {
+        return QImage();
+    }
+    QImage src = img;
+    if (src.format() != QImage::Format_RGB32 && src.format() != QImage::Format_ARGB32) {
+        src = src.convertToFormat(QImage::Format_ARGB32);
+    }
+
+    QImage gray(src.size(), QImage::Format_Grayscale8);
+    uchar *bits = gray.bits();
+    int bpl = gray.bytesPerLine();
+    int width = src.width();
+
+    parallelChunks(static_cast<size_t>(src.height()), GRAY_MIN_CHUNK_ROWS, [&](unsigned, size_t begin, size_t end) {
+        for (size_t y = begin; y < end; ++y) {
+            const QRgb *line = reinterpret_cast<const QRgb *>(src.constScanLine(static_cast<int>(y)));
+            grayRow(line, bits + y * bpl, width);
+        }
+    });
+    return gray;
+}
+
+int otsuThreshold(const QImage& gray, const QRect& rect)
+{
+    unsigned hist[256] = {0};
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        const uchar *line = gray.constScanLine(y);
+        for (int x = rect.left(); x <= rect.right(); ++x) {
+            hist[line[x]]++;
+        }
+    }
+
+    double total = static_cast<double>(rect.width()) * rect.height();
+    double sumAll = 0;
+    for (unsigned i = 0; i < 256; ++i) {
+        sumAll += static_cast<double>(i) * hist[i];
+    }
+
+    double w0 = 0, sum0 = 0, best = 0;
+    int threshold = 128;
+    for (unsigned t = 0; t < 255; ++t) {
+        w0 += hist[t];
+        sum0 += static_cast<double>(t) * hist[t];
+        double w1 = total - w0;
+        if (w0 == 0 || w1 == 0) {
+            continue;
+        }
+        double m0 = sum0 / w0;
+        double m1 = (sumAll - sum0) / w1;
+        double between = w0 * w1 * (m0 - m1) * (m0 - m1);
+        if (between > best) {
+            best = between;
+            threshold = static_cast<int>(t) + 1;
+        }
+    }
+    return threshold;
+}
+
+void thresholdRow(const uchar *gray, unsigned width, int threshold, unsigned char *row)
+{
+    unsigned x = 0;
+#ifdef PSF_USE_SSE2
+    if (threshold > 0 && threshold <= 256) {
+        // v < threshold  <=>  min(v, threshold - 1) == v
+        const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold - 1));
+        for (; x + 16 <= width; x += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(gray + x));
+            unsigned m = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(v, limit), v)));
+            row[x >> 3] = BITREV[m & 0xFF];
+            row[(x >> 3) + 1] = BITREV[m >> 8];
+        }
+    }
+#endif
+    for (; x < width; x += 8) {
+        unsigned n = std::min(8u, width - x);
+        unsigned bits = 0;
+        for (unsigned k = 0; k < n; ++k) {
+            bits |= static_cast<unsigned>(gray[x + k] < threshold) << (7 - k);
+        }
+        row[x >> 3] = static_cast<unsigned char>(bits);
+    }
+}
+
+void binarize(const QImage& gray, int x0, int y0, unsigned w, unsigned h,
+              const PSFImageOptions& opt, unsigned char *bits, unsigned rowBytes)
+{
+    memset(bits, 0, static_cast<size_t>(h) * rowBytes);
+    if (w == 0 || h == 0) {
+        return;
+    }
+
+    switch (opt.mode) {
+    case PSFBinarize::Fixed:
+    case PSFBinarize::Otsu: {
+        int t = (opt.mode == PSFBinarize::Fixed)
+                ? opt.threshold
+                : otsuThreshold(gray, QRect(x0, y0, static_cast<int>(w), static_cast<int>(h)));
+        for (unsigned y = 0; y < h; ++y) {
+            thresholdRow(gray.constScanLine(y0 + static_cast<int>(y)) + x0, w, t, bits + y * rowBytes);
+        }
+        break;
+    }
+    case PSFBinarize::FloydSteinberg: {
+        // Errors of the current and the next row, with a guard cell at each end
+        std::vector<int> cur(w + 2, 0), next(w + 2, 0);
+        for (unsigned y = 0; y < h; ++y) {
+            const uchar *line = gray.constScanLine(y0 + static_cast<int>(y)) + x0;
+            unsigned char *row = bits + y * rowBytes;
+            std::fill(next.begin(), next.end(), 0);
+            for (unsigned x = 0; x < w; ++x) {
+                int v = line[x] + cur[x + 1] / 16;
+                int out = (v < 128) ? 0 : 255;
+                if (out == 0) {
+                    row[x >> 3] |= static_cast<unsigned char>(0x80 >> (x & 7));
+                }
+                int e = v - out;
+                cur[x + 2] += e * 7;
+                next[x] += e * 3;
+                next[x + 1] += e * 5;
+                next[x + 2] += e;
+            }
+            cur.swap(next);
+        }
+        break;
+    }
+    case PSFBinarize::Ordered:
+        for (unsigned y = 0; y < h; ++y) {
+            const uchar *line = gray.constScanLine(y0 + static_cast<int>(y)) + x0;
+            unsigned char *row = bits + y * rowBytes;
+            const unsigned char *bayer = BAYER8[y & 7];
+            for (unsigned x = 0; x < w; ++x) {
+                if (line[x] < bayer[x & 7] * 4 + 2) {
+                    row[x >> 3] |= static_cast<unsigned char>(0x80 >> (x & 7));
+                }
+            }
+        }
+        break;
+    }
+}
+
+bool setGlyphFromImage(PSFGlyph& glyph, const QImage& img, const PSFImageOptions& opt)
+{
+    if (img.isNull()) {
+        return false;
+    }
+    PSFFont *font = glyph.getFont();
+    int gw = static_cast<int>(font->getWidth());
+    int gh = static_cast<int>(font->getHeight());
+
+    QImage src = img;
+    if (opt.scale && (src.width() != gw || src.height() != gh)) {
+        src = src.scaled(gw, gh, opt.keepAspect ? Qt::KeepAspectRatio : Qt::IgnoreAspectRatio,
+                         Qt::SmoothTransformation);
+    }
+    QImage gray = toGray8(src);
+    unsigned w = static_cast<unsigned>(std::min(gray.width(), gw));
+    unsigned h = static_cast<unsigned>(std::min(gray.height(), gh));
+
+    unsigned rowBytes = (font->getWidth() + 7) >> 3;
+    std::vector<unsigned char> pasted(static_cast<size_t>(h) * rowBytes);
+    binarize(gray, 0, 0, w, h, opt, pasted.data(), rowBytes);
+
+    // Pixels outside the image keep their value
+    std::vector<unsigned char> data = glyph.getData();
+    data.resize(font->getGlyphSize(), 0);
+    unsigned fullBytes = w >> 3;
+    unsigned char edgeMask = static_cast<unsigned char>(0xFF00 >> (w & 7));
+    for (unsigned y = 0; y < h; ++y) {
+        unsigned char *dst = &data[y * rowBytes];
+        const unsigned char *src = &pasted[y * rowBytes];
+        memcpy(dst, src, fullBytes);
+        if (edgeMask != 0) {
+            dst[fullBytes] = static_cast<unsigned char>((dst[fullBytes] & ~edgeMask) | (src[fullBytes] & edgeMask));
+        }
+    }
+    glyph.init(font, std::move(data));
+    return true;
+}
+
+}
@@ -0,0 +1,464 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include "psfjournal.h"
+#include "psfmmap.h"
+
+namespace {
+
+const unsigned char JOURNAL_MAGIC[4] = { 'P', 'S', 'F', 'J' };
+const unsigned JOURNAL_VERSION = 1;
+const size_t JOURNAL_HEADER_SIZE = 12;
+
+// Record: type, glyph index, byte offset, payload size, payload, checksum
+const size_t RECORD_HEADER_SIZE = 13;
+const unsigned char RECORD_BITMAP = 'B';  // payload: XOR delta starting at offset
+const unsigned char RECORD_UNICODE = 'U'; // payload: the glyph unicode values
+const unsigned char RECORD_COUNT = 'N';   // no payload, the font grew to <index> glyphs
+
+inline void put32(std::vector<unsigned char>& buf, unsigned int v)
+{
+    unsigned char b[4] = {
+        static_cast<unsigned char>(v), static_cast<unsigned char>(v >> 8),
+        static_cast<unsigned char>(v >> 16), static_cast<unsigned char>(v >> 24)
+    };
+    buf.insert(buf.end(), b, b + 4);
+}
+
+inline unsigned int get32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<unsigned>(p[3]) << 24);
+}
+
+unsigned int checksum(const unsigned char *p, size_t len)
+{
+    // FNV-1a
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+void appendRecord(std::vector<unsigned char>& buf, unsigned char type, unsigned int index,
+                  unsigned int offset, const unsigned char *payload, size_t size)
+{
+    size_t start = buf.size();
+    buf.push_back(type);
+    put32(buf, index);
+    put32(buf, offset);
+    put32(buf, static_cast<unsigned>(size));
+    buf.insert(buf.end(), payload, payload + size);
+    put32(buf, checksum(&buf[start], buf.size() - start));
+}
+
+/*
+ * Appends a bitmap record turning glyph <index> from <from> into <to>, if
+ * they differ. Both hold <size> bytes.
+ */
+void appendDelta(std::vector<unsigned char>& buf, unsigned int index,
+                 const unsigned char *from, const unsigned char *to, unsigned int size)
+{
+    unsigned first = 0, last = size;
+    while (first < size && to[first] == from[first]) { first++; }
+    while (last > first && to[last - 1] == from[last - 1]) { last--; }
+    if (first < last) {
+        std::vector<unsigned char> delta(last - first);
+        for (unsigned i = first; i < last; ++i) {
+            delta[i - first] = to[i] ^ from[i];
+        }
+        appendRecord(buf, RECORD_BITMAP, index, first, delta.data(), delta.size());
+    }
+}
+
+void appendUnicode(std::vector<unsigned char>& buf, unsigned int index, const std::vector<unsigned int>& vals)
+{
+    std::vector<unsigned char> payload;
+    for (unsigned int v : vals) {
+        put32(payload, v);
+    }
+    appendRecord(buf, RECORD_UNICODE, index, 0, payload.data(), payload.size());
+}
+
+bool writeAll(int fd, const unsigned char *p, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) { continue; }
+            return false;
+        }
+        p += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/*
+ * Calls fn(type, index, offset, payload, size) for every intact record in
+ * the journal <buf>, stopping at the first damaged one or when fn returns
+ * false.
+ *
+ * Returns:
+ *	the length of the valid part of the journal, 0 if the header is invalid
+ *	or was written for a different glyph size.
+ */
+template <typename Fn>
+size_t scanJournal(const unsigned char *buf, size_t size, unsigned int glyphsize, Fn fn)
+{
+    if (size < JOURNAL_HEADER_SIZE || memcmp(buf, JOURNAL_MAGIC, 4) != 0
+            || get32(buf + 4) != JOURNAL_VERSION || get32(buf + 8) != glyphsize) {
+        return 0;
+    }
+    size_t pos = JOURNAL_HEADER_SIZE;
+    while (size - pos >= RECORD_HEADER_SIZE + 4) {
+        const unsigned char *rec = buf + pos;
+        unsigned int psize = get32(rec + 9);
+        if (psize > size - pos - RECORD_HEADER_SIZE - 4) {
+            break;
+        }
+        size_t rlen = RECORD_HEADER_SIZE + psize;
+        if (get32(rec + rlen) != checksum(rec, rlen)) {
+            break;
+        }
+        if (!fn(rec[0], get32(rec + 1), get32(rec + 5), rec + RECORD_HEADER_SIZE, psize)) {
+            break;
+        }
+        pos += rlen + 4;
+    }
+    return pos;
+}
+
+}
+
+bool PSFJournal::hasRecords(const std::string& fontFile)
+{
+    PSFMappedFile file;
+    if (access(journalPath(fontFile).c_str(), F_OK) != 0 || !file.open(journalPath(fontFile).c_str())) {
+        return false;
+    }
+    if (file.size() < JOURNAL_HEADER_SIZE) {
+        return false;
+    }
+    bool found = false;
+    scanJournal(file.data(), file.size(), get32(file.data() + 8),
+                [&found](unsigned char, unsigned, unsigned, const unsigned char *, unsigned) {
+        found = true;
+        return false;
+    });
+    return found;
+}
+
+bool PSFJournal::replay(PSFFont& font, const std::string& fontFile, size_t *applied)
+{
+    PSFMappedFile file;
+    if (!file.open(journalPath(fontFile).c_str())) {
+        return false;
+    }
+    unsigned int gsize = font.getGlyphSize();
+    unsigned int numglyphs = font.getNumGlyphs();
+    if (file.size() < JOURNAL_HEADER_SIZE || get32(file.data() + 8) != gsize) {
+        fprintf(stderr, "%s: journal does not match the font\n", __func__);
+        return false;
+    }
+
+    // Edits are collected per glyph and stored once at the end
+    std::vector<std::vector<unsigned char>> bitmaps(numglyphs);
+    std::vector<std::vector<unsigned int>> unicodes(numglyphs);
+    std::vector<char> unicodeSet(numglyphs, 0);
+    unsigned int maxglyphs = (font.getVersion() == PSFVersion::V1) ? 512 : PSF_MAX_JOURNAL_GLYPHS;
+    size_t count = 0;
+    bool invalid = false;
+
+    size_t valid = scanJournal(file.data(), file.size(), gsize,
+                               [&](unsigned char type, unsigned index, unsigned offset, const unsigned char *p, unsigned size) {
+        if (type == RECORD_COUNT) {
+            if (index > maxglyphs) {
+                invalid = true;
+                return false;
+            }
+            if (index > bitmaps.size()) {
+                bitmaps.resize(index);
+                unicodes.resize(index);
+                unicodeSet.resize(index, 0);
+            }
+            count++;
+            return true;
+        }
+        if (index >= bitmaps.size()) {
+            invalid = true;
+            return false;
+        }
+        if (type == RECORD_BITMAP) {
+            if (offset > gsize || size > gsize - offset) {
+                invalid = true;
+                return false;
+            }
+            std::vector<unsigned char>& bits = bitmaps[index];
+            if (bits.empty()) {
+                // Glyphs the font grew by start out empty
+                bits = (index < numglyphs) ? font.getGlyph(index).getData() : std::vector<unsigned char>();
+                bits.resize(gsize, 0);
+            }
+            for (unsigned i = 0; i < size; ++i) {
+                bits[offset + i] ^= p[i];
+            }
+        } else if (type == RECORD_UNICODE) {
+            if ((size % 4) != 0) {
+                invalid = true;
+                return false;
+            }
+            unicodes[index].clear();
+            for (unsigned i = 0; i < size; i += 4) {
+                unicodes[index].push_back(get32(p + i));
+            }
+            unicodeSet[index] = 1;
+        } else {
+            invalid = true;
+            return false;
+        }
+        count++;
+        return true;
+    });
+
+    // Nothing is applied from a journal with records that do not fit the font
+    if (invalid) {
+        fprintf(stderr, "%s: invalid record after %zu records, the journal does not match the font\n",
+                __func__, count);
+        return false;
+    }
+    if (valid < file.size()) {
+        fprintf(stderr, "%s: ignoring %zu bytes of torn records after %zu records\n",
+                __func__, file.size() - valid, count);
+    }
+
+    // A PSF1 font grows by 256 glyphs at a time, every new glyph is initialized
+    try {
+        for (unsigned i = numglyphs; i < bitmaps.size() || i < font.getNumGlyphs(); ++i) {
+            font.addGlyph(i);
+        }
+    } catch (const std::out_of_range&) {
+        fprintf(stderr, "%s: the font cannot hold %zu glyphs\n", __func__, bitmaps.size());
+        return false;
+    }
+
+    for (unsigned i = 0; i < bitmaps.size(); ++i) {
+        PSFGlyph& glyph = font.getGlyph(i);
+        if (!bitmaps[i].empty()) {
+            glyph.init(&font, std::move(bitmaps[i]));
+        }
+        if (unicodeSet[i]) {
+            if (glyph.getFont() == nullptr) {
+                glyph.init(&font);
+            }
+            glyph.clearUnicodeVals();
+            for (unsigned int v : unicodes[i]) {
+                glyph.addUnicodeVal(v);
+            }
+        }
+    }
+    if (applied != nullptr) {
+        *applied = count;
+    }
+    return true;
+}
+
+bool PSFJournal::open(const std::string& fontFile, const PSFFont& font, bool append)
+{
+    if (!openFile(fontFile, font.getGlyphSize(), append)) {
+        return false;
+    }
+    setBase(font);
+    return true;
+}
+
+bool PSFJournal::openFile(const std::string& fontFile, unsigned int size, bool append)
+{
+    close();
+    path = journalPath(fontFile);
+    glyphsize = size;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pending.clear();
+    }
+
+    size_t validLength = 0;
+    if (append) {
+        PSFMappedFile file;
+        if (access(path.c_str(), F_OK) == 0 && file.open(path.c_str())) {
+            validLength = scanJournal(file.data(), file.size(), glyphsize,
+                                      [](unsigned char, unsigned, unsigned, const unsigned char *, unsigned) {
+                return true;
+            });
+        }
+    }
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        perror(__func__);
+        return false;
+    }
+    // Drop a torn tail, or everything when starting over
+    if (ftruncate(fd, static_cast<off_t>(validLength)) < 0
+            || lseek(fd, static_cast<off_t>(validLength), SEEK_SET) < 0) {
+        perror(__func__);
+        close();
+        return false;
+    }
+    if (validLength == 0) {
+        std::vector<unsigned char> hdr(JOURNAL_MAGIC, JOURNAL_MAGIC + 4);
+        put32(hdr, JOURNAL_VERSION);
+        put32(hdr, glyphsize);
+        if (!writeAll(fd, hdr.data(), hdr.size()) || fdatasync(fd) < 0) {
+            perror(__func__);
+            close();
+            return false;
+        }
+        validLength = hdr.size();
+    }
+    committedLength = static_cast<off_t>(validLength);
+    return true;
+}
+
+void PSFJournal::setBase(const PSFFont& font)
+{
+    unsigned int numglyphs = font.getNumGlyphs();
+    bitmaps.assign(numglyphs, std::vector<unsigned char>());
+    unicodes.assign(numglyphs, std::vector<unsigned int>());
+    for (unsigned i = 0; i < numglyphs; ++i) {
+        const PSFGlyph& glyph = font.getGlyph(i);
+        bitmaps[i] = glyph.getData();
+        bitmaps[i].resize(glyphsize, 0);
+        unicodes[i] = glyph.getUnicodeValues();
+    }
+}
+
+void PSFJournal::record(unsigned int index, const PSFGlyph& glyph)
+{
+    if (fd < 0) {
+        return;
+    }
+    std::vector<unsigned char> recs;
+
+    // Glyphs added to the font are logged first, so replay can grow the font
+    unsigned int count = index + 1;
+    if (glyph.getFont() != nullptr) {
+        count = std::max(count, glyph.getFont()->getNumGlyphs());
+    }
+    if (count > bitmaps.size()) {
+        bitmaps.resize(count, std::vector<unsigned char>(glyphsize, 0));
+        unicodes.resize(count);
+        appendRecord(recs, RECORD_COUNT, count, 0, nullptr, 0);
+    }
+
+    const std::vector<unsigned char>& data = glyph.getData();
+    if (data.size() == glyphsize) {
+        appendDelta(recs, index, bitmaps[index].data(), data.data(), glyphsize);
+        bitmaps[index] = data;
+    }
+
+    const std::vector<unsigned int>& vals = glyph.getUnicodeValues();
+    if (vals != unicodes[index]) {
+        appendUnicode(recs, index, vals);
+        unicodes[index] = vals;
+    }
+
+    if (!recs.empty()) {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pending.insert(pending.end(), recs.begin(), recs.end());
+    }
+}
+
+bool PSFJournal::commit()
+{
+    std::vector<unsigned char> buf;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        buf.swap(pending);
+    }
+    if (buf.empty() || fd < 0) {
+        return true;
+    }
+    if (!writeAll(fd, buf.data(), buf.size()) || fdatasync(fd) < 0) {
+        perror(__func__);
+        // Drop a partly written group and queue it again, so later records
+        // do not land behind a torn one and the next commit retries it
+        if (ftruncate(fd, committedLength) < 0 || lseek(fd, committedLength, SEEK_SET) < 0) {
+            perror(__func__);
+        }
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        buf.insert(buf.end(), pending.begin(), pending.end());
+        pending.swap(buf);
+        return false;
+    }
+    committedLength += static_cast<off_t>(buf.size());
+    return true;
+}
+
+bool PSFJournal::rebase(const std::string& fontFile, const PSFFont& saved, const PSFFont& current)
+{
+    std::string oldPath = path;
+    unsigned int numsaved = saved.getNumGlyphs();
+    bool tracking = isOpen() && glyphsize == saved.getGlyphSize() && bitmaps.size() >= numsaved;
+    if (!openFile(fontFile, saved.getGlyphSize(), false)) {
+        return false;
+    }
+    if (!oldPath.empty() && oldPath != path) {
+        unlink(oldPath.c_str());
+    }
+    if (!tracking) {
+        setBase(saved);
+        for (unsigned i = 0; i < current.getNumGlyphs(); ++i) {
+            record(i, current.getGlyph(i));
+        }
+        return true;
+    }
+
+    // The glyph state kept here is already that of the current font, only
+    // the glyphs edited after <saved> was taken need records
+    std::vector<unsigned char> recs;
+    std::vector<unsigned char> empty(glyphsize, 0);
+    const std::vector<unsigned int> none;
+    if (bitmaps.size() > numsaved) {
+        appendRecord(recs, RECORD_COUNT, static_cast<unsigned>(bitmaps.size()), 0, nullptr, 0);
+    }
+    for (unsigned i = 0; i < bitmaps.size(); ++i) {
+        const PSFGlyph *glyph = (i < numsaved) ? &saved.getGlyph(i) : nullptr;
+        bool edited = (glyph == nullptr || i >= current.getNumGlyphs()
+                       || glyph->getGeneration() != current.getGlyph(i).getGeneration());
+        if (edited) {
+            const unsigned char *from = (glyph != nullptr && glyph->getData().size() == glyphsize)
+                                        ? glyph->getData().data() : empty.data();
+            appendDelta(recs, i, from, bitmaps[i].data(), glyphsize);
+        }
+        if (unicodes[i] != ((glyph != nullptr) ? glyph->getUnicodeValues() : none)) {
+            appendUnicode(recs, i, unicodes[i]);
+        }
+    }
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    pending.swap(recs);
+    return true;
+}
+
+void PSFJournal::remove()
+{
+    close();
+    if (!path.empty()) {
+        unlink(path.c_str());
+    }
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    pending.clear();
+}
+
+void PSFJournal::close()
+{
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+}
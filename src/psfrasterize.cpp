@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <utility>
+#include <QFontDatabase>
+#include <QFontMetrics>
+#include <QPainter>
+#include <QRegularExpression>
+#include "psfrasterize.h"
+#include "psfimage.h"
+#include "psfparallel.h"
+#include "psfutil.h"
+
+namespace {
+
+// Minimum amount of code points rendered by a worker
+const size_t RASTER_MIN_CHUNK_GLYPHS = 256;
+
+inline bool isSurrogate(unsigned cp)
+{
+    return cp >= 0xD800 && cp <= 0xDFFF;
+}
+
+}
+
+namespace PSF {
+
+bool parseCodepointRanges(const QString& text, std::vector<unsigned>& codepoints)
+{
+    QStringList tokens = splitTokens(text, QRegularExpression("[\\s,]+"));
+
+    codepoints.clear();
+    for (const QString& tok : tokens) {
+        int dash = tok.indexOf('-');
+        unsigned first, last;
+        if (dash < 0) {
+            if (!parseCodepoint(tok, first)) {
+                return false;
+            }
+            last = first;
+        } else if (!parseCodepoint(tok.left(dash), first) || !parseCodepoint(tok.mid(dash + 1), last)
+                   || last < first) {
+            return false;
+        }
+        for (unsigned cp = first; cp <= last; ++cp) {
+            if (!isSurrogate(cp)) {
+                codepoints.push_back(cp);
+            }
+        }
+    }
+    std::sort(codepoints.begin(), codepoints.end());
+    codepoints.erase(std::unique(codepoints.begin(), codepoints.end()), codepoints.end());
+    return true;
+}
+
+int rasterizeFont(PSFFont& font, const QFont& qfont, const std::vector<unsigned>& codepoints,
+                  const PSFRasterOptions& opt, PSFProgress *progress)
+{
+    size_t n = codepoints.size();
+    if (n == 0 || opt.width == 0 || opt.height == 0) {
+        return -1;
+    }
+    if (progress != nullptr) {
+        progress->setTotal(n);
+    }
+
+    unsigned rowBytes = (opt.width + 7) >> 3;
+    size_t glyphsize = static_cast<size_t>(rowBytes) * opt.height;
+    // Code points skipped as missing keep an empty bitmap
+    std::vector<std::vector<unsigned char>> bitmaps(n);
+
+    // Text can only be drawn on several threads at once where Qt supports it
+    size_t minChunk = QFontDatabase::supportsThreadedFontRendering() ? RASTER_MIN_CHUNK_GLYPHS : n;
+    parallelChunks(n, minChunk, [&](unsigned, size_t begin, size_t end) {
+        QFont f(qfont);
+        f.setPixelSize(opt.pixelSize);
+        f.setStyleStrategy(opt.antialias ? QFont::PreferAntialias : QFont::NoAntialias);
+        f.setHintingPreference(opt.hinting ? QFont::PreferFullHinting : QFont::PreferNoHinting);
+        QFontMetrics fm(f);
+        int baseline = (opt.baseline >= 0) ? opt.baseline : fm.ascent();
+
+        QImage img(static_cast<int>(opt.width), static_cast<int>(opt.height), QImage::Format_RGB32);
+        PSFImageOptions binarizeOpt;
+        binarizeOpt.threshold = opt.threshold;
+
+        for (size_t i = begin; i < end; ++i) {
+            if (progress != nullptr) {
+                if (progress->isCanceled()) {
+                    return;
+                }
+                progress->advance();
+            }
+            uint cp = codepoints[i];
+            if (opt.skipMissing && !fm.inFontUcs4(cp)) {
+                continue;
+            }
+
+            img.fill(Qt::white);
+            QPainter painter(&img);
+            painter.setFont(f);
+            painter.setPen(Qt::black);
+            painter.drawText(0, baseline, QString::fromUcs4(&cp, 1));
+            painter.end();
+
+            bitmaps[i].resize(glyphsize);
+            binarize(toGray8(img), 0, 0, opt.width, opt.height, binarizeOpt, bitmaps[i].data(), rowBytes);
+        }
+    });
+    if (progress != nullptr && progress->isCanceled()) {
+        return -1;
+    }
+
+    unsigned count = static_cast<unsigned>(std::count_if(bitmaps.begin(), bitmaps.end(),
+                                           [](const std::vector<unsigned char>& b) { return !b.empty(); }));
+    if (count == 0) {
+        return -1;
+    }
+
+    PSFFont out;
+    out.init(PSFVersion::V2, opt.width, opt.height);
+    out.addGlyph(count - 1);
+    unsigned g = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (bitmaps[i].empty()) {
+            continue;
+        }
+        PSFGlyph& glyph = out.getGlyph(g++);
+        glyph.init(&out, std::move(bitmaps[i]));
+        glyph.addUnicodeVal(codepoints[i]);
+    }
+    font.swap(out);
+    return static_cast<int>(count);
+}
+
+}
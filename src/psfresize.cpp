@@ -0,0 +1,406 @@
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "psfresize.h"
+#include "glyphview.h"
+#include "psfparallel.h"
+
+namespace {
+
+// Minimum amount of glyphs scaled by a worker
+const size_t RESIZE_MIN_CHUNK_GLYPHS = 256;
+
+// Minimum amount of glyphs scanned or re-packed by a worker when relaying out
+const size_t RELAYOUT_MIN_CHUNK_GLYPHS = 4096;
+
+// Widest horizontal factor of PSFScaleMode::Nearest (8 pixels become 64 bits)
+const unsigned MAX_NEAREST_FACTOR = 8;
+
+typedef std::vector<std::vector<unsigned char>> Bitmaps;
+
+/*
+ * Unpacks a glyph bitmap into one byte (0 or 1) per pixel.
+ */
+void unpackPixels(const std::vector<unsigned char>& data, unsigned w, unsigned h, std::vector<unsigned char>& px)
+{
+    unsigned rowBytes = (w + 7) >> 3;
+    px.assign(static_cast<size_t>(w) * h, 0);
+    if (data.size() < static_cast<size_t>(rowBytes) * h) {
+        return;
+    }
+    for (unsigned y = 0; y < h; ++y) {
+        const unsigned char *row = &data[y * rowBytes];
+        unsigned char *dst = &px[static_cast<size_t>(y) * w];
+        for (unsigned x = 0; x < w; ++x) {
+            dst[x] = (row[x >> 3] >> (7 - (x & 7))) & 1;
+        }
+    }
+}
+
+/*
+ * Packs one byte per pixel back into a glyph bitmap.
+ */
+void packPixels(const std::vector<unsigned char>& px, unsigned w, unsigned h, std::vector<unsigned char>& data)
+{
+    unsigned rowBytes = (w + 7) >> 3;
+    data.assign(static_cast<size_t>(rowBytes) * h, 0);
+    for (unsigned y = 0; y < h; ++y) {
+        const unsigned char *src = &px[static_cast<size_t>(y) * w];
+        unsigned char *row = &data[y * rowBytes];
+        for (unsigned x = 0; x < w; ++x) {
+            if (src[x]) {
+                row[x >> 3] |= static_cast<unsigned char>(0x80 >> (x & 7));
+            }
+        }
+    }
+}
+
+void scaleNearest(const std::vector<unsigned char>& data, const std::vector<uint64_t>& lut,
+                  unsigned sw, unsigned sh, unsigned fx, unsigned fy, std::vector<unsigned char>& out)
+{
+    unsigned srcRowBytes = (sw + 7) >> 3;
+    unsigned dstRowBytes = (sw * fx + 7) >> 3;
+    out.assign(static_cast<size_t>(dstRowBytes) * sh * fy, 0);
+    if (data.size() < static_cast<size_t>(srcRowBytes) * sh) {
+        return;
+    }
+
+    for (unsigned y = 0; y < sh; ++y) {
+        unsigned char *row = &out[static_cast<size_t>(y) * fy * dstRowBytes];
+        // Source byte k spreads to fx bytes starting at byte k * fx
+        for (unsigned k = 0; k < srcRowBytes; ++k) {
+            uint64_t v = lut[data[y * srcRowBytes + k]];
+            for (unsigned b = 0; b < fx; ++b) {
+                unsigned pos = k * fx + b;
+                if (pos < dstRowBytes) {
+                    row[pos] = static_cast<unsigned char>(v >> (8 * (fx - 1 - b)));
+                }
+            }
+        }
+        for (unsigned r = 1; r < fy; ++r) {
+            memcpy(row + r * dstRowBytes, row, dstRowBytes);
+        }
+    }
+}
+
+void scale2x(const std::vector<unsigned char>& px, unsigned w, unsigned h, std::vector<unsigned char>& out)
+{
+    unsigned ow = w * 2;
+    out.assign(static_cast<size_t>(ow) * h * 2, 0);
+    for (unsigned y = 0; y < h; ++y) {
+        for (unsigned x = 0; x < w; ++x) {
+            unsigned char E = px[y * w + x];
+            unsigned char B = (y > 0) ? px[(y - 1) * w + x] : E;
+            unsigned char H = (y + 1 < h) ? px[(y + 1) * w + x] : E;
+            unsigned char D = (x > 0) ? px[y * w + x - 1] : E;
+            unsigned char F = (x + 1 < w) ? px[y * w + x + 1] : E;
+            unsigned char *o = &out[static_cast<size_t>(y) * 2 * ow + x * 2];
+
+            if (B != H && D != F) {
+                o[0] = (D == B) ? D : E;
+                o[1] = (B == F) ? F : E;
+                o[ow] = (D == H) ? D : E;
+                o[ow + 1] = (H == F) ? F : E;
+            } else {
+                o[0] = o[1] = o[ow] = o[ow + 1] = E;
+            }
+        }
+    }
+}
+
+void scale3x(const std::vector<unsigned char>& px, unsigned w, unsigned h, std::vector<unsigned char>& out)
+{
+    unsigned ow = w * 3;
+    out.assign(static_cast<size_t>(ow) * h * 3, 0);
+    auto at = [&](int x, int y, unsigned char def) {
+        return (x < 0 || y < 0 || x >= static_cast<int>(w) || y >= static_cast<int>(h)) ? def : px[y * w + x];
+    };
+
+    for (unsigned y = 0; y < h; ++y) {
+        for (unsigned x = 0; x < w; ++x) {
+            int ix = static_cast<int>(x), iy = static_cast<int>(y);
+            unsigned char E = px[y * w + x];
+            unsigned char A = at(ix - 1, iy - 1, E), B = at(ix, iy - 1, E), C = at(ix + 1, iy - 1, E);
+            unsigned char D = at(ix - 1, iy, E), F = at(ix + 1, iy, E);
+            unsigned char G = at(ix - 1, iy + 1, E), H = at(ix, iy + 1, E), I = at(ix + 1, iy + 1, E);
+            unsigned char *o = &out[static_cast<size_t>(y) * 3 * ow + x * 3];
+
+            if (B != H && D != F) {
+                o[0] = (D == B) ? D : E;
+                o[1] = ((D == B && E != C) || (B == F && E != A)) ? B : E;
+                o[2] = (B == F) ? F : E;
+                o[ow] = ((D == B && E != G) || (D == H && E != A)) ? D : E;
+                o[ow + 1] = E;
+                o[ow + 2] = ((B == F && E != I) || (H == F && E != C)) ? F : E;
+                o[2 * ow] = (D == H) ? D : E;
+                o[2 * ow + 1] = ((D == H && E != I) || (H == F && E != G)) ? H : E;
+                o[2 * ow + 2] = (H == F) ? F : E;
+            } else {
+                for (unsigned r = 0; r < 3; ++r) {
+                    o[r * ow] = o[r * ow + 1] = o[r * ow + 2] = E;
+                }
+            }
+        }
+    }
+}
+
+void scaleBox(const std::vector<unsigned char>& px, unsigned sw, unsigned sh,
+              unsigned dw, unsigned dh, unsigned coverage, std::vector<unsigned char>& out)
+{
+    out.assign(static_cast<size_t>(dw) * dh, 0);
+    for (unsigned dy = 0; dy < dh; ++dy) {
+        unsigned y0 = dy * sh / dh, y1 = (dy + 1) * sh / dh;
+        for (unsigned dx = 0; dx < dw; ++dx) {
+            unsigned x0 = dx * sw / dw, x1 = (dx + 1) * sw / dw;
+            unsigned set = 0;
+            for (unsigned y = y0; y < y1; ++y) {
+                for (unsigned x = x0; x < x1; ++x) {
+                    set += px[y * sw + x];
+                }
+            }
+            unsigned area = (x1 - x0) * (y1 - y0);
+            out[static_cast<size_t>(dy) * dw + dx] = (set * 100 >= coverage * area) ? 1 : 0;
+        }
+    }
+}
+
+/*
+ * Stores into <out> (<nout> words) the multiword value <in> (<nin> words,
+ * least significant first) shifted left by <shift> bits, or right if
+ * <shift> is negative.
+ */
+void shiftWords(const uint64_t *in, unsigned nin, long shift, uint64_t *out, unsigned nout)
+{
+    auto word = [&](long k) { return (k >= 0 && k < static_cast<long>(nin)) ? in[k] : uint64_t(0); };
+    for (unsigned i = 0; i < nout; ++i) {
+        // Source bit that lands on bit 0 of out[i]
+        long start = 64L * i - shift;
+        long w = (start >= 0) ? start / 64 : -((63 - start) / 64);
+        unsigned off = static_cast<unsigned>(start - w * 64);
+        uint64_t v = word(w) >> off;
+        if (off != 0) {
+            v |= word(w + 1) << (64 - off);
+        }
+        out[i] = v;
+    }
+}
+
+/*
+ * Replaces <dst> with a font of <width> x <height> glyphs holding <bitmaps>
+ * and the unicode values of <src>.
+ */
+void buildResizedFont(const PSFFont& src, PSFFont& dst, unsigned width, unsigned height, Bitmaps& bitmaps)
+{
+    PSFVersion version = (src.isVersion1() && width == 8 && height <= 255) ? PSFVersion::V1 : PSFVersion::V2;
+    PSFFont out;
+    out.init(version, width, height);
+
+    unsigned n = src.getNumGlyphs();
+    if (n > 0) {
+        out.addGlyph(n - 1);
+    }
+    for (unsigned i = 0; i < n; ++i) {
+        PSFGlyph& glyph = out.getGlyph(i);
+        glyph.init(&out, std::move(bitmaps[i]));
+        for (unsigned uni : src.getGlyph(i).getUnicodeValues()) {
+            glyph.addUnicodeVal(uni);
+        }
+    }
+    dst.swap(out);
+}
+
+}
+
+namespace PSF {
+
+bool rescaleFont(const PSFFont& src, PSFFont& dst, unsigned width, unsigned height,
+                 PSFScaleMode mode, unsigned coverage)
+{
+    unsigned sw = src.getWidth();
+    unsigned sh = src.getHeight();
+    if (width == 0 || height == 0 || sw == 0 || sh == 0) {
+        return false;
+    }
+
+    unsigned fx = width / sw, fy = height / sh;
+    switch (mode) {
+    case PSFScaleMode::Nearest:
+        if (width % sw != 0 || height % sh != 0 || fx > MAX_NEAREST_FACTOR) {
+            fprintf(stderr, "%s: nearest scaling needs whole factors (at most %u horizontally)\n",
+                    __func__, MAX_NEAREST_FACTOR);
+            return false;
+        }
+        break;
+    case PSFScaleMode::Scale2x:
+    case PSFScaleMode::Scale3x: {
+        unsigned f = (mode == PSFScaleMode::Scale2x) ? 2 : 3;
+        if (width != sw * f || height != sh * f) {
+            fprintf(stderr, "%s: Scale%ux needs a %ux%u target\n", __func__, f, sw * f, sh * f);
+            return false;
+        }
+        break;
+    }
+    case PSFScaleMode::Box:
+        if (width > sw || height > sh || coverage == 0 || coverage > 100) {
+            fprintf(stderr, "%s: box scaling only shrinks the font\n", __func__);
+            return false;
+        }
+        break;
+    }
+
+    // Spreads every bit of a byte into fx bits
+    std::vector<uint64_t> lut;
+    if (mode == PSFScaleMode::Nearest) {
+        lut.resize(256);
+        uint64_t ones = (uint64_t(1) << fx) - 1;
+        for (unsigned b = 0; b < 256; ++b) {
+            uint64_t v = 0;
+            for (int bit = 7; bit >= 0; --bit) {
+                v = (v << fx) | (((b >> bit) & 1u) ? ones : 0);
+            }
+            lut[b] = v;
+        }
+    }
+
+    unsigned n = src.getNumGlyphs();
+    Bitmaps bitmaps(n);
+    parallelChunks(n, RESIZE_MIN_CHUNK_GLYPHS, [&](unsigned, size_t begin, size_t end) {
+        std::vector<unsigned char> px, scaled;
+        for (size_t i = begin; i < end; ++i) {
+            const std::vector<unsigned char>& data = src.getGlyph(static_cast<unsigned>(i)).getData();
+            if (mode == PSFScaleMode::Nearest) {
+                scaleNearest(data, lut, sw, sh, fx, fy, bitmaps[i]);
+                continue;
+            }
+            unpackPixels(data, sw, sh, px);
+            if (mode == PSFScaleMode::Scale2x) {
+                scale2x(px, sw, sh, scaled);
+            } else if (mode == PSFScaleMode::Scale3x) {
+                scale3x(px, sw, sh, scaled);
+            } else {
+                scaleBox(px, sw, sh, width, height, coverage, scaled);
+            }
+            packPixels(scaled, width, height, bitmaps[i]);
+        }
+    });
+
+    buildResizedFont(src, dst, width, height, bitmaps);
+    return true;
+}
+
+PSFBoundingBox fontBoundingBox(const PSFFont& font)
+{
+    unsigned w = font.getWidth();
+    unsigned h = font.getHeight();
+    unsigned rowBytes = (w + 7) >> 3;
+    unsigned n = font.getNumGlyphs();
+
+    // Every chunk ORs its rows into one row and tracks the first and last
+    // non empty row
+    struct Extent {
+        std::vector<unsigned char> orRow;
+        unsigned top;
+        unsigned bottom;
+    };
+    unsigned nchunks = chunkCount(n, RELAYOUT_MIN_CHUNK_GLYPHS);
+    std::vector<Extent> extents(nchunks, Extent{std::vector<unsigned char>(rowBytes, 0), h, 0});
+
+    parallelChunks(n, RELAYOUT_MIN_CHUNK_GLYPHS, [&](unsigned chunk, size_t begin, size_t end) {
+        Extent& e = extents[chunk];
+        for (size_t i = begin; i < end; ++i) {
+            const std::vector<unsigned char>& data = font.getGlyph(static_cast<unsigned>(i)).getData();
+            if (data.size() < static_cast<size_t>(rowBytes) * h) {
+                continue;
+            }
+            for (unsigned y = 0; y < h; ++y) {
+                const unsigned char *row = &data[y * rowBytes];
+                unsigned char any = 0;
+                for (unsigned k = 0; k < rowBytes; ++k) {
+                    e.orRow[k] |= row[k];
+                    any |= row[k];
+                }
+                if (any != 0) {
+                    e.top = std::min(e.top, y);
+                    e.bottom = std::max(e.bottom, y + 1);
+                }
+            }
+        }
+    });
+
+    std::vector<unsigned char> orRow(rowBytes, 0);
+    unsigned top = h, bottom = 0;
+    for (const Extent& e : extents) {
+        for (unsigned k = 0; k < rowBytes; ++k) {
+            orRow[k] |= e.orRow[k];
+        }
+        top = std::min(top, e.top);
+        bottom = std::max(bottom, e.bottom);
+    }
+
+    PSFBoundingBox bb;
+    if (top >= bottom) {
+        return bb;
+    }
+    unsigned left = w, right = 0;
+    GlyphView<0> view(orRow.data(), w, 1);
+    for (unsigned x = 0; x < w; ++x) {
+        if (view.pixel(x, 0)) {
+            left = std::min(left, x);
+            right = x + 1;
+        }
+    }
+    bb.left = left;
+    bb.top = top;
+    bb.width = right - left;
+    bb.height = bottom - top;
+    return bb;
+}
+
+bool relayoutFont(const PSFFont& src, PSFFont& dst, unsigned width, unsigned height,
+                  int shiftX, int shiftY)
+{
+    if (width == 0 || height == 0) {
+        return false;
+    }
+    unsigned sw = src.getWidth();
+    unsigned sh = src.getHeight();
+    unsigned srcWords = rowWords(sw);
+    unsigned dstWords = rowWords(width);
+    size_t glyphsize = static_cast<size_t>((width + 7) >> 3) * height;
+    // Pixel x sits at bit (width - 1 - x) of a right aligned row value
+    long shift = static_cast<long>(width) - static_cast<long>(sw) - shiftX;
+
+    unsigned n = src.getNumGlyphs();
+    Bitmaps bitmaps(n);
+    parallelChunks(n, RELAYOUT_MIN_CHUNK_GLYPHS, [&](unsigned, size_t begin, size_t end) {
+        std::vector<uint64_t> in(srcWords), out(dstWords);
+        for (size_t i = begin; i < end; ++i) {
+            const std::vector<unsigned char>& data = src.getGlyph(static_cast<unsigned>(i)).getData();
+            std::vector<unsigned char>& result = bitmaps[i];
+            result.assign(glyphsize, 0);
+            if (data.size() < static_cast<size_t>((sw + 7) >> 3) * sh) {
+                continue;
+            }
+            GlyphView<0> from(data.data(), sw, sh);
+            GlyphView<0, unsigned char> to(result.data(), width, height);
+
+            for (unsigned y = 0; y < height; ++y) {
+                long sy = static_cast<long>(y) - shiftY;
+                if (sy < 0 || sy >= static_cast<long>(sh)) {
+                    continue;
+                }
+                from.rowValue(static_cast<unsigned>(sy), in.data());
+                shiftWords(in.data(), srcWords, shift, out.data(), dstWords);
+                to.setRowValue(y, out.data());
+            }
+        }
+    });
+
+    buildResizedFont(src, dst, width, height, bitmaps);
+    return true;
+}
+
+}
@@ -0,0 +1,220 @@
+#include <climits>
+#include <algorithm>
+#include <utility>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QTextStream>
+#include "psfsheet.h"
+#include "psfimage.h"
+#include "psfparallel.h"
+#include "psfutil.h"
+
+namespace {
+
+// Minimum amount of cells (import) or glyphs (export) per worker
+const size_t SHEET_MIN_CHUNK_GLYPHS = 64;
+
+// Cells of the code point list without code point
+const unsigned NO_CODEPOINT = UINT_MAX;
+
+}
+
+namespace PSF {
+
+int loadFromSpriteSheet(PSFFont& font, const QImage& sheet, const PSFSheetLayout& layout,
+                        const std::vector<unsigned>& codepoints)
+{
+    unsigned sw = static_cast<unsigned>(sheet.width());
+    unsigned sh = static_cast<unsigned>(sheet.height());
+    if (layout.cellWidth == 0 || layout.cellHeight == 0
+            || sw < layout.marginX + layout.cellWidth || sh < layout.marginY + layout.cellHeight) {
+        return -1;
+    }
+
+    unsigned pitchX = layout.cellWidth + layout.spacingX;
+    unsigned pitchY = layout.cellHeight + layout.spacingY;
+    unsigned fitCols = (sw - layout.marginX + layout.spacingX) / pitchX;
+    unsigned rows = (sh - layout.marginY + layout.spacingY) / pitchY;
+    if (layout.columns > fitCols) {
+        return -1;
+    }
+    unsigned cols = (layout.columns != 0) ? layout.columns : fitCols;
+    size_t cells = static_cast<size_t>(cols) * rows;
+    if (layout.count > cells) {
+        return -1;
+    }
+    if (layout.count != 0) {
+        cells = layout.count;
+    }
+    if (font.isVersion1() && layout.startIndex + cells > 512) {
+        return -2;
+    }
+    // Checked before the font is touched, so a bad list changes nothing
+    if (font.isVersion1()) {
+        for (size_t i = 0; i < cells && i < codepoints.size(); ++i) {
+            if (codepoints[i] > 0xFFFF && codepoints[i] != NO_CODEPOINT) {
+                return -3;
+            }
+        }
+    }
+
+    QImage gray = toGray8(sheet);
+    unsigned rowBytes = (font.getWidth() + 7) >> 3;
+    unsigned glyphsize = font.getGlyphSize();
+    unsigned w = std::min(layout.cellWidth, font.getWidth());
+    unsigned h = std::min(layout.cellHeight, font.getHeight());
+    PSFImageOptions opt;
+    opt.threshold = layout.threshold;
+    std::vector<std::vector<unsigned char>> bitmaps(cells);
+
+    parallelChunks(cells, SHEET_MIN_CHUNK_GLYPHS, [&](unsigned, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            unsigned cx = layout.marginX + static_cast<unsigned>(i % cols) * pitchX;
+            unsigned cy = layout.marginY + static_cast<unsigned>(i / cols) * pitchY;
+            std::vector<unsigned char>& data = bitmaps[i];
+            data.assign(glyphsize, 0);
+            binarize(gray, static_cast<int>(cx), static_cast<int>(cy), w, h, opt, data.data(), rowBytes);
+        }
+    });
+
+    unsigned oldCount = font.getNumGlyphs();
+    unsigned last = layout.startIndex + static_cast<unsigned>(cells) - 1;
+    if (last >= oldCount) {
+        // A PSF1 font rounds up to 256 or 512 glyphs, every new one is initialized
+        font.addGlyph(last);
+        for (unsigned i = oldCount; i < font.getNumGlyphs(); ++i) {
+            font.getGlyph(i).init(&font);
+        }
+    }
+    for (size_t i = 0; i < cells; ++i) {
+        PSFGlyph& glyph = font.getGlyph(layout.startIndex + static_cast<unsigned>(i));
+        glyph.init(&font, std::move(bitmaps[i]));
+        if (i < codepoints.size()) {
+            glyph.clearUnicodeVals();
+            if (codepoints[i] <= 0x10FFFF) {
+                glyph.addUnicodeVal(codepoints[i]);
+            }
+        }
+    }
+    return static_cast<int>(cells);
+}
+
+bool readCodepointList(const QString& filename, std::vector<unsigned>& codepoints)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return false;
+    }
+    QString text = QTextStream(&file).readAll();
+    QStringList tokens = splitTokens(text, QRegularExpression("\\s+"));
+
+    codepoints.clear();
+    for (const QString& tok : tokens) {
+        unsigned cp = NO_CODEPOINT;
+        if (tok != "-" && !parseCodepoint(tok, cp)) {
+            return false;
+        }
+        codepoints.push_back(cp);
+    }
+    return true;
+}
+
+bool saveToSpriteSheet(const PSFFont& font, const QString& pngFile, unsigned columns)
+{
+    unsigned n = font.getNumGlyphs();
+    unsigned fw = font.getWidth();
+    unsigned fh = font.getHeight();
+    if (n == 0 || columns == 0) {
+        return false;
+    }
+    unsigned cols = std::min(columns, n);
+    unsigned rows = (n + cols - 1) / cols;
+    unsigned rowBytes = (fw + 7) >> 3;
+
+    QImage img(static_cast<int>(cols * fw), static_cast<int>(rows * fh), QImage::Format_Grayscale8);
+    if (img.isNull()) {
+        return false;
+    }
+    img.fill(0xFF);
+    uchar *bits = img.bits();
+    int bpl = img.bytesPerLine();
+
+    parallelChunks(n, SHEET_MIN_CHUNK_GLYPHS, [&](unsigned, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const std::vector<unsigned char>& data = font.getGlyph(static_cast<unsigned>(i)).getData();
+            if (data.empty()) {
+                continue;
+            }
+            unsigned cx = static_cast<unsigned>(i % cols) * fw;
+            unsigned cy = static_cast<unsigned>(i / cols) * fh;
+            for (unsigned y = 0; y < fh; ++y) {
+                const unsigned char *src = &data[y * rowBytes];
+                uchar *dst = bits + static_cast<size_t>(cy + y) * bpl + cx;
+                for (unsigned x = 0; x < fw; ++x) {
+                    dst[x] = (src[x >> 3] & (0x80 >> (x & 7))) ? 0x00 : 0xFF;
+                }
+            }
+        }
+    });
+
+    if (!img.convertToFormat(QImage::Format_Mono, Qt::ThresholdDither).save(pngFile, "PNG")) {
+        return false;
+    }
+
+    QJsonArray glyphs;
+    for (unsigned i = 0; i < n; ++i) {
+        QJsonObject g;
+        g["index"] = static_cast<int>(i);
+        g["x"] = static_cast<int>((i % cols) * fw);
+        g["y"] = static_cast<int>((i / cols) * fh);
+
+        QJsonArray cps, seqs, seq;
+        bool inSeq = false;
+        for (unsigned v : font.getGlyph(i).getUnicodeValues()) {
+            if (v == PSF1_STARTSEQ) {
+                if (inSeq && !seq.isEmpty()) {
+                    seqs.append(seq);
+                }
+                seq = QJsonArray();
+                inSeq = true;
+            } else if (inSeq) {
+                seq.append(static_cast<int>(v));
+            } else {
+                cps.append(static_cast<int>(v));
+            }
+        }
+        if (inSeq && !seq.isEmpty()) {
+            seqs.append(seq);
+        }
+        if (!cps.isEmpty()) {
+            g["codepoints"] = cps;
+        }
+        if (!seqs.isEmpty()) {
+            g["sequences"] = seqs;
+        }
+        glyphs.append(g);
+    }
+
+    QFileInfo fi(pngFile);
+    QJsonObject root;
+    root["image"] = fi.fileName();
+    root["glyphWidth"] = static_cast<int>(fw);
+    root["glyphHeight"] = static_cast<int>(fh);
+    root["columns"] = static_cast<int>(cols);
+    root["rows"] = static_cast<int>(rows);
+    root["count"] = static_cast<int>(n);
+    root["glyphs"] = glyphs;
+
+    QFile json(fi.path() + "/" + fi.completeBaseName() + ".json");
+    if (!json.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    QByteArray bytes = QJsonDocument(root).toJson();
+    return json.write(bytes) == bytes.size();
+}
+
+}
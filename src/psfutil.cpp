@@ -1,99 +1,178 @@
+#include <cctype>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <string>
 #include <QtGlobal>
 #include "psfutil.h"
+#include "glyphview.h"
+#include "psfimage.h"
+#include "psfbdf.h"
+#include "psfhex.h"
+#include "psfcompiled.h"
+
+namespace {
+
+// Largest code point accepted by parseCodepoint()
+const unsigned MAX_CODEPOINT = 0x10FFFF;
+
+inline int digitValue(char c)
+{
+    if (c >= '0' && c <= '9') { return c - '0'; }
+    if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+    if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+    return -1;
+}
+
+/*
+ * Parses the base 2 (bitsPerDigit 1) or base 16 (bitsPerDigit 4) digits
+ * starting at <p> into the right aligned row value <words>, stopping at the
+ * first character that is not a digit. Digits that do not fit in <nwords>
+ * words are dropped.
+ *
+ * Returns:
+ *	a pointer behind the last digit, <p> if there was none.
+ */
+const char *parseRowValue(const char *p, const char *end, unsigned bitsPerDigit,
+                          uint64_t *words, unsigned nwords)
+{
+    const char *q = p;
+    while (q < end && digitValue(*q) >= 0 && digitValue(*q) < (1 << bitsPerDigit)) {
+        ++q;
+    }
+    std::fill(words, words + nwords, 0);
+
+    // Digits are placed from the right, each one lands inside a single word
+    unsigned bit = 0;
+    for (const char *r = q; r-- > p && bit < nwords * 64; bit += bitsPerDigit) {
+        words[bit / 64] |= static_cast<uint64_t>(digitValue(*r)) << (bit % 64);
+    }
+    return q;
+}
+
+/*
+ * Appends the right aligned row value <words> of a <width> pixel row as
+ * (width + 3) / 4 upper case hex digits.
+ */
+void appendRowHex(std::string& out, const uint64_t *words, unsigned width)
+{
+    static const char hexdig[] = "0123456789ABCDEF";
+    unsigned dig = (width + 3) / 4;
+    size_t pos = out.size();
+
+    out.resize(pos + dig);
+    for (unsigned d = 0; d < dig; ++d) {
+        unsigned bit = d * 4;
+        out[pos + dig - 1 - d] = hexdig[(words[bit / 64] >> (bit % 64)) & 0xF];
+    }
+}
+
+}
 
 namespace PSF {
 
 bool setGlyphFromText(PSFGlyph &glyph, const QString &txt) {
     unsigned w = glyph.getFont()->getWidth();
-    unsigned y = 0;
-
-    QStringList sl = txt.split('\n');
-    foreach (QString s, sl) {
-        bool ok;
-        uint32_t val = 0;
-
-        if (s.startsWith("0b")) {
-            s = s.mid(2);
-            val = s.toUInt(&ok, 2);
-        } else if (s.startsWith("0x")) {
-            s = s.mid(2);
-            val = s.toUInt(&ok, 16);
-        } else {
-            ok = false;
-        }
+    unsigned h = glyph.getFont()->getHeight();
+    std::vector<unsigned char> data = glyph.getData();
+    data.resize(glyph.getFont()->getGlyphSize(), 0);
+    std::vector<uint64_t> words(rowWords(w));
 
-        if (!ok) {
-            return false;
-        }
-        unsigned x = w - 1;
-        for (unsigned i = 0; i < w; i++) {
-            glyph.setPixel(x, y, (val & (1 << i)) != 0);
-            x--;
+    bool result = dispatchGlyphWidth(w, [&](auto tag) {
+        constexpr unsigned W = decltype(tag)::value;
+        GlyphView<W, unsigned char> view(data.data(), w, h);
+        unsigned y = 0;
+
+        QStringList sl = txt.split('\n');
+        foreach (QString s, sl) {
+            unsigned bitsPerDigit;
+            s = s.trimmed();
+
+            if (s.startsWith("0b")) {
+                bitsPerDigit = 1;
+            } else if (s.startsWith("0x")) {
+                bitsPerDigit = 4;
+            } else {
+                return false;
+            }
+            std::string digits = s.mid(2).toStdString();
+            const char *end = digits.data() + digits.size();
+            if (digits.empty() || parseRowValue(digits.data(), end, bitsPerDigit, words.data(), words.size()) != end) {
+                return false;
+            }
+
+            if (y < h) {
+                if constexpr (W != 0) {
+                    view.setRow(y, static_cast<typename GlyphView<W>::Row>(words[0]));
+                } else {
+                    view.setRowValue(y, words.data());
+                }
+            }
+            y++;
         }
-        y++;
-    }
-    return true;
+        return true;
+    });
+
+    // Rows parsed before an error are kept
+    glyph.init(glyph.getFont(), std::move(data));
+    return result;
 }
 
 bool setGlyphFromImage(PSFGlyph &glyph, const QImage &img) {
-    int gw = static_cast<int>(glyph.getWidth());
-    int gh = static_cast<int>(glyph.getHeight());
-    int w = qMin(img.width(), gw);
-    int h = qMin(img.height(), gh);
-
-    for (int y = 0; y < h; y ++) {
-        for (int x = 0; x < w; x++) {
-            QRgb rgb = img.pixel(x, y);
-            int a = qAlpha(rgb);
-            int r = qRed(rgb);
-            int g = qGreen(rgb);
-            int b = qBlue(rgb);
-
-            unsigned grey = ((r + g + b) / 3);
-            unsigned pix = img.hasAlphaChannel()? ((a >= 128) && (grey < 128)) : (grey < 128);
-            glyph.setPixel(x, y, pix);
-        }
-    }
-
-    return true;
+    return setGlyphFromImage(glyph, img, PSFImageOptions());
 }
 
 QString glyphToHexString(const PSFGlyph &glyph) {
     unsigned width = glyph.getWidth();
     unsigned height = glyph.getHeight();
-    QString result = "";
+    const std::vector<unsigned char>& data = glyph.getData();
+    std::vector<unsigned char> empty;
+    if (data.empty()) {
+        empty.resize(glyph.getFont()->getGlyphSize(), 0);
+    }
+    const unsigned char *bits = data.empty() ? empty.data() : data.data();
+    std::vector<uint64_t> words(rowWords(width));
+    std::string result;
 
-    int dig = (width + 3) / 4;
+    result.reserve(height * ((width + 3) / 4 + 1));
+    dispatchGlyphWidth(width, [&](auto tag) {
+        constexpr unsigned W = decltype(tag)::value;
+        GlyphView<W> view(bits, width, height);
 
-    for (unsigned y = 0; y < height; y ++) {
-        uint32_t rv = 0;
-        for (unsigned x = 0; x < width; x++) {
-            if (glyph.getPixel(x, y) != 0) {
-                rv |= 1u << (width - (x + 1));
+        for (unsigned y = 0; y < height; y ++) {
+            if constexpr (W != 0) {
+                words[0] = view.row(y);
+            } else {
+                view.rowValue(y, words.data());
             }
+            appendRowHex(result, words.data(), width);
+            result += '\n';
         }
-        result += QString("%1").arg(rv, dig, 16, QChar('0')).toUpper() + '\n';
-    }
+    });
 
-    return result;
+    return QString::fromLatin1(result.data(), static_cast<int>(result.size()));
 }
 
 QImage glyphToImage(const PSFGlyph &glyph) {
     unsigned width = glyph.getWidth();
     unsigned height = glyph.getHeight();
     QImage img(width, height, QImage::Format_RGB32);
+    const std::vector<unsigned char>& data = glyph.getData();
 
-    for (unsigned y = 0; y < height; y ++) {
-        for (unsigned x = 0; x < width; x++) {
-            if (glyph.getPixel(x, y)) {
-                img.setPixel(x, y, qRgb(0x0, 0x0, 0x0));
-            } else {
-                img.setPixel(x, y, qRgb(0xff, 0xff, 0xff));
+    if (data.empty()) {
+        img.fill(qRgb(0xff, 0xff, 0xff));
+        return img;
+    }
+    dispatchGlyphWidth(width, [&](auto tag) {
+        GlyphView<decltype(tag)::value> view(data.data(), width, height);
+
+        for (unsigned y = 0; y < height; y ++) {
+            QRgb *line = reinterpret_cast<QRgb *>(img.scanLine(static_cast<int>(y)));
+            for (unsigned x = 0; x < width; x++) {
+                line[x] = view.pixel(x, y) ? qRgb(0x0, 0x0, 0x0) : qRgb(0xff, 0xff, 0xff);
             }
         }
-    }
+    });
 
     return img;
 }
@@ -112,7 +191,8 @@ bool saveToVerilogMif(const PSFFont &font, const std::string& filename) {
     return true;
 }
 
-bool loadFromVerilogMif(PSFFont &font, unsigned gw, unsigned gh, const std::string &filename) {
+bool loadFromVerilogMif(PSFFont &font, unsigned gw, unsigned gh, const std::string &filename,
+                        PSFProgress *progress) {
     std::ifstream in(filename, std::ios::in|std::ios::binary);
 
     if(!in.is_open()) {
@@ -124,34 +204,56 @@ bool loadFromVerilogMif(PSFFont &font, unsigned gw, unsigned gh, const std::stri
 
     PSFVersion v = (gw <= 8)? PSFVersion::V1 : PSFVersion::V2;
     font.init(v, gw, gh);
+    if (progress != nullptr) {
+        progress->setTotal(256);
+    }
 
-    while(!in.eof()) {
-        PSFGlyph& glyph = font.addGlyph(index);
-        std::string text;
-
-        for (unsigned y = 0; (y < gh) && !in.eof(); y++) {
-            std::getline(in, text);
-            line++;
-            unsigned val;
+    bool ok = dispatchGlyphWidth(gw, [&](auto tag) {
+        constexpr unsigned W = decltype(tag)::value;
 
-            try { val = std::stoi(text, nullptr, 16); }
-            catch (std::invalid_argument&) {
-                std::cerr << "Invalid hex value '" << text << "' at line " << line << "\n";
-                return false;
+        while(!in.eof()) {
+            if (progress != nullptr) {
+                if (progress->isCanceled()) { return false; }
+                progress->advance();
             }
-            for (unsigned x = 0; x < gw; x++) {
-                unsigned pix = (val & (1 << (gw - x - 1))) != 0;
-                if (!glyph.setPixel(x, y, pix)) {
-                    std::cerr << "Glyph set pixel failed\n";
+            PSFGlyph& glyph = font.addGlyph(index);
+            std::vector<unsigned char> data(font.getGlyphSize(), 0);
+            GlyphView<W, unsigned char> view(data.data(), gw, gh);
+            std::vector<uint64_t> words(rowWords(gw));
+            std::string text;
+
+            for (unsigned y = 0; (y < gh) && !in.eof(); y++) {
+                std::getline(in, text);
+                line++;
+                const char *p = text.data();
+                const char *end = p + text.size();
+                while (p < end && isspace(static_cast<unsigned char>(*p))) {
+                    ++p;
+                }
+                if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+                    p += 2;
+                }
+                if (parseRowValue(p, end, 4, words.data(), words.size()) == p) {
+                    std::cerr << "Invalid hex value '" << text << "' at line " << line << "\n";
                     return false;
                 }
+                if constexpr (W != 0) {
+                    view.setRow(y, static_cast<typename GlyphView<W>::Row>(words[0]));
+                } else {
+                    view.setRowValue(y, words.data());
+                }
+            }
+            glyph.init(&font, std::move(data));
+            index++;
+            if (index > 255) {
+                std::cerr << "WARNING: Too many lines in file '" << filename << "'\n";
+                break;
             }
         }
-        index++;
-        if (index > 255) {
-            std::cerr << "WARNING: Too many lines in file '" << filename << "'\n";
-            break;
-        }
+        return true;
+    });
+    if (!ok) {
+        return false;
     }
     in.close();
 
@@ -162,4 +264,42 @@ bool loadFromVerilogMif(PSFFont &font, unsigned gw, unsigned gh, const std::stri
     return true;
 }
 
+QStringList splitTokens(const QString &text, const QRegularExpression &separators)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    return text.split(separators, Qt::SkipEmptyParts);
+#else
+    return text.split(separators, QString::SkipEmptyParts);
+#endif
+}
+
+bool parseCodepoint(const QString &tok, unsigned &cp)
+{
+    bool ok;
+    if (tok.startsWith("U+", Qt::CaseInsensitive) || tok.startsWith("0x", Qt::CaseInsensitive)) {
+        cp = tok.mid(2).toUInt(&ok, 16);
+    } else {
+        cp = tok.toUInt(&ok, 10);
+    }
+    return ok && cp <= MAX_CODEPOINT && !(cp >= 0xD800 && cp <= 0xDFFF);
+}
+
+bool loadFontFile(PSFFont &font, const std::string &filename) {
+    std::string ext;
+    size_t dot = filename.find_last_of('.');
+    if (dot != std::string::npos) {
+        ext = filename.substr(dot + 1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    }
+
+    if (ext == "psfc") {
+        return loadFromCompiled(font, filename);
+    } else if (ext == "bdf") {
+        return loadFromBdf(font, filename);
+    } else if (ext == "hex") {
+        return loadFromUnifontHex(font, filename);
+    }
+    return font.loadFromFile(filename.c_str());
+}
+
 }
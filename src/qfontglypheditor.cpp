@@ -1,6 +1,11 @@
 #include <QPainter>
+#include <QPaintEvent>
+#include <QRegion>
+#include <QVector>
+#include <QLine>
 #include <QDebug>
 #include "qfontglypheditor.h"
+#include "glyphview.h"
 
 QFontGlyphEditor::QFontGlyphEditor(QWidget *parent) :
     QWidget(parent),
@@ -10,7 +15,10 @@ QFontGlyphEditor::QFontGlyphEditor(QWidget *parent) :
     drag_started(false),
     editor_enabled(false),
     glyph_edited(false),
-    glyph_index(-1)
+    glyph_index(-1),
+    raster_valid(false),
+    raster_glyph(-1),
+    raster_generation(0)
 { }
 
 void QFontGlyphEditor::updateCanvasInfo() {
@@ -32,83 +40,177 @@ void QFontGlyphEditor::updateCanvasInfo() {
     int x = (size().width() - canvas.width()) / 2;
     int y = (size().height() - canvas.height()) / 2;
     canvas.setPos(x, y);
+    raster_valid = false;
 }
 
 bool QFontGlyphEditor::findPointInCanvas(const QPoint &pt, QPoint &cpt) {
-    if (!hasGlyph()) {
+    if (!hasGlyph() || canvas.dotWidth() <= 0 || canvas.dotHeight() <= 0) {
+        return false;
+    }
+    // Dot (gx, gy) covers [x1 + gx * dotWidth + 1, x1 + (gx + 1) * dotWidth + 1)
+    int dx = pt.x() - canvas.x1() - 1;
+    int dy = pt.y() - canvas.y1() - 1;
+    if (dx < 0 || dy < 0) {
+        return false;
+    }
+    int gx = dx / canvas.dotWidth();
+    int gy = dy / canvas.dotHeight();
+    if (gx >= canvas.glyphWidth() || gy >= canvas.glyphHeight()) {
         return false;
     }
-    int y = canvas.y1();
-    for (int gy = 0; gy < canvas.glyphHeight(); gy ++) {
-        int x = canvas.x1();
-        for (int gx = 0; gx < canvas.glyphWidth(); gx++) {
-            QRect r(x + 1, y + 1, canvas.dotWidth(), canvas.dotHeight());
+    cpt.setX(gx);
+    cpt.setY(gy);
+    return true;
+}
 
-            if (r.contains(pt)) {
-                cpt.setX(gx);
-                cpt.setY(gy);
-                return true;
-            }
-            x += canvas.dotWidth();
-        }
-        y += canvas.dotHeight();
+/*
+ * Appends to <points> the dots on the line from <from> to <to> (Bresenham),
+ * excluding <from> itself.
+ */
+static void rasterizeLine(const QPoint &from, const QPoint &to, QVector<QPoint> &points) {
+    int x = from.x(), y = from.y();
+    int dx = qAbs(to.x() - x), sx = (x < to.x()) ? 1 : -1;
+    int dy = -qAbs(to.y() - y), sy = (y < to.y()) ? 1 : -1;
+    int err = dx + dy;
+
+    while (x != to.x() || y != to.y()) {
+        int e2 = 2 * err;
+        if (e2 >= dy) { err += dy; x += sx; }
+        if (e2 <= dx) { err += dx; y += sy; }
+        points.append(QPoint(x, y));
     }
-    return false;
 }
 
-void QFontGlyphEditor::flipGlyphPoint(const QPoint &gpt) {
+void QFontGlyphEditor::flipGlyphPoints(const QVector<QPoint> &gpts) {
+    if (gpts.isEmpty()) {
+        return;
+    }
     PSFGlyph& glyph = getCurrGlyph();
-    unsigned gx = static_cast<unsigned>(gpt.x());
-    unsigned gy = static_cast<unsigned>(gpt.y());
-    glyph.setPixel(gx, gy, !glyph.getPixel(gx, gy));
-    repaint();
+    bool sync_raster = raster_valid && raster_glyph == glyph_index
+                        && raster_generation == glyph.getGeneration();
+    QPainter painter;
+    QRect dirty;
+
+    if (sync_raster) {
+        painter.begin(&raster);
+    }
+    for (const QPoint &gpt : gpts) {
+        unsigned gx = static_cast<unsigned>(gpt.x());
+        unsigned gy = static_cast<unsigned>(gpt.y());
+        bool set = !glyph.getPixel(gx, gy);
+        glyph.setPixel(gx, gy, set);
+
+        // Keep the cached raster in sync and only repaint the touched dots
+        if (sync_raster) {
+            drawDot(painter, gpt.x(), gpt.y(), set);
+        }
+        dirty |= dotRect(gpt.x(), gpt.y());
+    }
+    if (sync_raster) {
+        painter.end();
+        raster_generation = glyph.getGeneration();
+    }
+    glyph_edited = true;
+    update(dirty);
+    emit glyphChanged(glyph_index);
 }
 
-void QFontGlyphEditor::drawGlyph(QPainter &painter) {
-    const PSFGlyph& glyph = getCurrGlyph();
-    int y = canvas.y1();
-    for (int gy = 0; gy < canvas.glyphHeight(); gy ++) {
-        int x = canvas.x1();
-        for (int gx = 0; gx < canvas.glyphWidth(); gx++) {
-            QRect r(x + 1, y + 1, canvas.dotWidth(), canvas.dotHeight());
-
-            // Glyph dot
-            if (glyph.getPixel(gx, gy) != 0) {
-                painter.fillRect(r, QColor(255, 140, 0));
-            } else {
-                painter.fillRect(r, QColor(0, 43, 54));
-            }
+/*
+ * Returns the area covered by the glyph dot (gx, gy) in widget coordinates
+ */
+QRect QFontGlyphEditor::dotRect(int gx, int gy) {
+    return QRect(canvas.x1() + gx * canvas.dotWidth() + 1, canvas.y1() + gy * canvas.dotHeight() + 1,
+                 canvas.dotWidth() - 1, canvas.dotHeight() - 1);
+}
 
-            // X grid line
-            painter.setPen(QPen(QColor(192, 192, 192), 1, Qt::SolidLine));
-            painter.drawLine(x, canvas.y1(), x, canvas.y2());
+void QFontGlyphEditor::drawDot(QPainter &painter, int gx, int gy, bool set) {
+    QRect r(gx * canvas.dotWidth() + 1, gy * canvas.dotHeight() + 1,
+            canvas.dotWidth() - 1, canvas.dotHeight() - 1);
 
-            x += canvas.dotWidth();
-        }
+    painter.fillRect(r, set ? QColor(255, 140, 0) : QColor(0, 43, 54));
+}
+
+/*
+ * Renders the grid and all the glyph dots into the raster. The raster is
+ * only rebuilt when the glyph, the canvas geometry or the glyph contents
+ * changed behind the editor's back.
+ */
+void QFontGlyphEditor::rebuildRaster() {
+    const PSFGlyph& glyph = getCurrGlyph();
+    qreal dpr = devicePixelRatioF();
+
+    raster = QImage(QSize(canvas.width() + 1, canvas.height() + 1) * dpr, QImage::Format_RGB32);
+    raster.setDevicePixelRatio(dpr);
+    raster.fill(QColor(0, 43, 54));
 
-        // Y grid line
-        painter.setPen(QPen(QColor(192, 192, 192), 1, Qt::SolidLine));
-        painter.drawLine(canvas.x1(), y, canvas.x2(), y);
+    QPainter painter(&raster);
+    const std::vector<unsigned char>& data = glyph.getData();
+    unsigned gw = static_cast<unsigned>(canvas.glyphWidth());
+    unsigned gh = static_cast<unsigned>(canvas.glyphHeight());
+    if (!data.empty()) {
+        PSF::dispatchGlyphWidth(gw, [&](auto tag) {
+            constexpr unsigned W = decltype(tag)::value;
+            PSF::GlyphView<W> view(data.data(), gw, gh);
 
-        y += canvas.dotHeight();
+            for (unsigned gy = 0; gy < gh; gy ++) {
+                if constexpr (W != 0) {
+                    if (view.row(gy) == 0) {
+                        continue;
+                    }
+                }
+                for (unsigned gx = 0; gx < gw; gx++) {
+                    if (view.pixel(gx, gy)) {
+                        drawDot(painter, static_cast<int>(gx), static_cast<int>(gy), true);
+                    }
+                }
+            }
+        });
     }
 
+    // All the grid lines in one batch
+    QVector<QLine> lines;
+    lines.reserve(canvas.glyphWidth() + canvas.glyphHeight() + 2);
+    for (int gx = 0; gx <= canvas.glyphWidth(); gx++) {
+        int x = gx * canvas.dotWidth();
+        lines.append(QLine(x, 0, x, canvas.height()));
+    }
+    for (int gy = 0; gy <= canvas.glyphHeight(); gy++) {
+        int y = gy * canvas.dotHeight();
+        lines.append(QLine(0, y, canvas.width(), y));
+    }
     painter.setPen(QPen(QColor(192, 192, 192), 1, Qt::SolidLine));
-    painter.drawLine(canvas.x2(), canvas.y1(), canvas.x2(), canvas.y2());
-    painter.drawLine(canvas.x1(), canvas.y2(), canvas.x2(), canvas.y2());
+    painter.drawLines(lines);
+
+    raster_valid = true;
+    raster_glyph = glyph_index;
+    raster_generation = glyph.getGeneration();
 }
 
 void QFontGlyphEditor::paintEvent(QPaintEvent *e) {
-    Q_UNUSED(e);
-
     QPainter painter(this);
-    int w = size().width();
-    int h = size().height();
+    QRect canvasRect(canvas.x1(), canvas.y1(), canvas.width() + 1, canvas.height() + 1);
 
-    painter.fillRect(0, 0, w, h, QColor(72, 71, 65));
+    if (!hasGlyph()) {
+        painter.fillRect(e->rect(), QColor(72, 71, 65));
+        return;
+    }
+    if (!raster_valid || raster_glyph != glyph_index
+            || raster_generation != getCurrGlyph().getGeneration()) {
+        rebuildRaster();
+    }
 
-    if (hasGlyph()) {
-        drawGlyph(painter);
+    // Background around the canvas
+    QRegion bg = QRegion(e->rect()).subtracted(QRegion(canvasRect));
+    for (const QRect &r : bg) {
+        painter.fillRect(r, QColor(72, 71, 65));
+    }
+
+    QRect exposed = e->rect() & canvasRect;
+    if (!exposed.isEmpty()) {
+        QRect src = exposed.translated(-canvas.x1(), -canvas.y1());
+        qreal dpr = raster.devicePixelRatio();
+        painter.drawImage(exposed, raster, QRectF(src.x() * dpr, src.y() * dpr,
+                                                  src.width() * dpr, src.height() * dpr));
     }
 }
 
@@ -118,22 +220,23 @@ void QFontGlyphEditor::mousePressEvent(QMouseEvent *e) {
     }
     if (e->button() == Qt::LeftButton) {
         if (findPointInCanvas(e->pos(), prev_sel_point)) {
-            flipGlyphPoint(prev_sel_point);
+            flipGlyphPoints(QVector<QPoint>() << prev_sel_point);
             drag_started = true;
         }
     }
 }
 
 void QFontGlyphEditor::mouseMoveEvent(QMouseEvent *e) {
-    Q_UNUSED(e);
-
     if (drag_started) {
         QPoint cpt;
         if (!findPointInCanvas(e->pos(), cpt)) {
             return;
         }
         if (prev_sel_point != cpt) {
-            flipGlyphPoint(cpt);
+            // Fill in the dots skipped between two mouse events
+            QVector<QPoint> stroke;
+            rasterizeLine(prev_sel_point, cpt, stroke);
+            flipGlyphPoints(stroke);
             prev_sel_point = cpt;
         }
     }
@@ -167,6 +270,6 @@ void QFontGlyphEditor::wheelEvent(QWheelEvent *e) {
         dot_height = MIN_DOT_HEIGHT;
     }
     updateCanvasInfo();
-    repaint();
+    update();
 }
 
@@ -0,0 +1,162 @@
+#include <QPainter>
+#include <QScrollBar>
+#include <QVector>
+#include <QLine>
+#include "qfontsheetview.h"
+
+QFontSheetView::QFontSheetView(QWidget *parent) :
+    QAbstractScrollArea(parent),
+    zoom(DEFAULT_SHEET_ZOOM),
+    current_glyph(-1)
+{ }
+
+void QFontSheetView::setFont(PSFFont *font)
+{
+    atlas.setFont(font);
+    current_glyph = -1;
+    updateScrollBars();
+    viewport()->update();
+}
+
+void QFontSheetView::setCurrentGlyph(int index)
+{
+    QRect old = viewRectOfTile(current_glyph);
+    current_glyph = index;
+    viewport()->update(old.adjusted(-2, -2, 2, 2));
+
+    QRect r = viewRectOfTile(index);
+    if (r.isNull()) {
+        return;
+    }
+    viewport()->update(r.adjusted(-2, -2, 2, 2));
+
+    // Scroll just enough to show the current glyph
+    if (r.top() < 0 || r.bottom() > viewport()->height()) {
+        verticalScrollBar()->setValue(verticalScrollBar()->value() + r.top() - viewport()->height() / 2);
+    }
+    if (r.left() < 0 || r.right() > viewport()->width()) {
+        horizontalScrollBar()->setValue(horizontalScrollBar()->value() + r.left() - viewport()->width() / 2);
+    }
+}
+
+void QFontSheetView::updateGlyph(int index)
+{
+    if (atlas.updateGlyph(index)) {
+        viewport()->update(viewRectOfTile(index));
+    }
+}
+
+void QFontSheetView::setZoom(int z)
+{
+    z = qBound(MIN_SHEET_ZOOM, z, MAX_SHEET_ZOOM);
+    if (z == zoom) {
+        return;
+    }
+    zoom = z;
+    updateScrollBars();
+    viewport()->update();
+}
+
+QRect QFontSheetView::viewRectOfTile(int index) const
+{
+    if (atlas.isNull() || index < 0 || index >= atlas.glyphCount()) {
+        return QRect();
+    }
+    QRect t = atlas.tileRect(index);
+    return QRect(t.x() * zoom - horizontalScrollBar()->value(),
+                 t.y() * zoom - verticalScrollBar()->value(),
+                 t.width() * zoom, t.height() * zoom);
+}
+
+void QFontSheetView::updateScrollBars()
+{
+    QSize content = atlas.isNull() ? QSize(0, 0) : atlas.image().size() * zoom;
+    QSize view = viewport()->size();
+
+    horizontalScrollBar()->setRange(0, qMax(0, content.width() - view.width()));
+    horizontalScrollBar()->setPageStep(view.width());
+    horizontalScrollBar()->setSingleStep(atlas.tileWidth() * zoom);
+    verticalScrollBar()->setRange(0, qMax(0, content.height() - view.height()));
+    verticalScrollBar()->setPageStep(view.height());
+    verticalScrollBar()->setSingleStep(atlas.tileHeight() * zoom);
+}
+
+void QFontSheetView::paintEvent(QPaintEvent *e)
+{
+    QPainter painter(viewport());
+    painter.fillRect(e->rect(), QColor(72, 71, 65));
+
+    if (atlas.isNull()) {
+        return;
+    }
+
+    int sx = horizontalScrollBar()->value();
+    int sy = verticalScrollBar()->value();
+
+    // Atlas area covered by the exposed rectangle, snapped to whole pixels
+    QRect exposed = e->rect().translated(sx, sy);
+    QRect src(exposed.left() / zoom, exposed.top() / zoom,
+              exposed.width() / zoom + 2, exposed.height() / zoom + 2);
+    src &= atlas.image().rect();
+    if (src.isEmpty()) {
+        return;
+    }
+    QRect dst(src.x() * zoom - sx, src.y() * zoom - sy, src.width() * zoom, src.height() * zoom);
+    painter.drawImage(dst, atlas.image(), src);
+
+    // Tile borders, batched into one call
+    if (zoom > 1) {
+        int tw = atlas.tileWidth(), th = atlas.tileHeight();
+        int c1 = src.left() / tw, c2 = (src.right() / tw) + 1;
+        int r1 = src.top() / th, r2 = (src.bottom() / th) + 1;
+        QVector<QLine> lines;
+        lines.reserve((c2 - c1 + 1) + (r2 - r1 + 1));
+        for (int c = c1; c <= c2; c++) {
+            int x = c * tw * zoom - sx;
+            lines.append(QLine(x, dst.top(), x, dst.bottom()));
+        }
+        for (int r = r1; r <= r2; r++) {
+            int y = r * th * zoom - sy;
+            lines.append(QLine(dst.left(), y, dst.right(), y));
+        }
+        painter.setPen(QPen(QColor(72, 71, 65), 1, Qt::SolidLine));
+        painter.drawLines(lines);
+    }
+
+    QRect cur = viewRectOfTile(current_glyph);
+    if (!cur.isNull() && cur.intersects(e->rect())) {
+        painter.setPen(QPen(QColor(192, 192, 192), 2, Qt::SolidLine));
+        painter.drawRect(cur.adjusted(-1, -1, 0, 0));
+    }
+}
+
+void QFontSheetView::resizeEvent(QResizeEvent *e)
+{
+    QAbstractScrollArea::resizeEvent(e);
+    updateScrollBars();
+}
+
+void QFontSheetView::mousePressEvent(QMouseEvent *e)
+{
+    if (e->button() != Qt::LeftButton || atlas.isNull()) {
+        return;
+    }
+    QPoint pt((e->pos().x() + horizontalScrollBar()->value()) / zoom,
+              (e->pos().y() + verticalScrollBar()->value()) / zoom);
+    int index = atlas.glyphAt(pt);
+    if (index >= 0) {
+        emit glyphClicked(index);
+    }
+}
+
+void QFontSheetView::wheelEvent(QWheelEvent *e)
+{
+    if (!(e->modifiers() & Qt::ControlModifier)) {
+        QAbstractScrollArea::wheelEvent(e);
+        return;
+    }
+    int delta = e->angleDelta().y();
+    if (delta != 0) {
+        setZoom(zoom + ((delta > 0) ? 1 : -1));
+    }
+}
@@ -0,0 +1,72 @@
+#include <QPainter>
+#include "qglyphdiffview.h"
+#include "psfdiff.h"
+#include "glyphview.h"
+
+// Gap between the two panels, in pixels
+static const int PANEL_GAP = 16;
+
+QGlyphDiffView::QGlyphDiffView(QWidget *parent) :
+    QWidget(parent),
+    gw(0),
+    gh(0)
+{ }
+
+void QGlyphDiffView::setGlyphs(const PSFGlyph *a, const PSFGlyph *b, unsigned width, unsigned height)
+{
+    size_t size = static_cast<size_t>((width + 7) >> 3) * height;
+    gw = width;
+    gh = height;
+
+    bitsA.assign(size, 0);
+    bitsB.assign(size, 0);
+    if (a != nullptr && a->getData().size() == size) {
+        bitsA = a->getData();
+    }
+    if (b != nullptr && b->getData().size() == size) {
+        bitsB = b->getData();
+    }
+    mask.resize(size);
+    PSF::diffBitmaps(bitsA.data(), bitsB.data(), size, mask.data());
+    update();
+}
+
+void QGlyphDiffView::drawPanel(QPainter &painter, const QRect &r, const std::vector<unsigned char> &bits, int dot)
+{
+    PSF::GlyphView<0> view(bits.data(), gw, gh);
+    PSF::GlyphView<0> diff(mask.data(), gw, gh);
+
+    painter.fillRect(r, Qt::white);
+    for (unsigned y = 0; y < gh; ++y) {
+        for (unsigned x = 0; x < gw; ++x) {
+            bool set = view.pixel(x, y);
+            bool changed = diff.pixel(x, y);
+            if (!set && !changed) {
+                continue;
+            }
+            QColor color = changed ? (set ? QColor(Qt::red) : QColor(255, 200, 200)) : QColor(Qt::black);
+            painter.fillRect(r.x() + static_cast<int>(x) * dot, r.y() + static_cast<int>(y) * dot, dot, dot, color);
+        }
+    }
+    painter.setPen(Qt::gray);
+    painter.drawRect(r.adjusted(0, 0, -1, -1));
+}
+
+void QGlyphDiffView::paintEvent(QPaintEvent *)
+{
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().window());
+    if (gw == 0 || gh == 0) {
+        return;
+    }
+
+    int dot = qMin((width() - PANEL_GAP) / static_cast<int>(2 * gw), height() / static_cast<int>(gh));
+    dot = qMax(dot, 1);
+    int pw = dot * static_cast<int>(gw);
+    int ph = dot * static_cast<int>(gh);
+    int x0 = (width() - 2 * pw - PANEL_GAP) / 2;
+    int y0 = (height() - ph) / 2;
+
+    drawPanel(painter, QRect(x0, y0, pw, ph), bitsA, dot);
+    drawPanel(painter, QRect(x0 + pw + PANEL_GAP, y0, pw, ph), bitsB, dot);
+}
@@ -0,0 +1,49 @@
+#include <QString>
+#include <QVariant>
+#include "qglyphlistmodel.h"
+#include "psfutil.h"
+
+QGlyphListModel::QGlyphListModel(QObject *parent) :
+    QAbstractListModel(parent),
+    font(nullptr)
+{ }
+
+void QGlyphListModel::setFont(PSFFont *_font)
+{
+    beginResetModel();
+    font = _font;
+    endResetModel();
+}
+
+void QGlyphListModel::glyphChanged(int glyphIndex)
+{
+    if (glyphIndex < 0 || glyphIndex >= rowCount()) {
+        return;
+    }
+    QModelIndex idx = index(glyphIndex);
+    emit dataChanged(idx, idx);
+}
+
+int QGlyphListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || font == nullptr) {
+        return 0;
+    }
+    return static_cast<int>(font->getNumGlyphs());
+}
+
+QVariant QGlyphListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) {
+        return QVariant();
+    }
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return QString::number(index.row());
+    case Qt::UserRole:
+        return QVariant::fromValue(&font->getGlyph(static_cast<unsigned>(index.row())));
+    default:
+        return QVariant();
+    }
+}
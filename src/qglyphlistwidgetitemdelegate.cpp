@@ -1,4 +1,5 @@
 #include <cstdint>
+#include <cstring>
 #include <QString>
 #include <QVariant>
 #include <QPainter>
@@ -6,47 +7,84 @@
 #include "qfontglypheditor.h"
 #include "psfutil.h"
 
+QGlyphListWidgetItemDelegate::QGlyphListWidgetItemDelegate(QWidget *parent) :
+    QStyledItemDelegate(parent),
+    font(nullptr),
+    cache(THUMBNAIL_CACHE_BYTES)
+{ }
+
+void QGlyphListWidgetItemDelegate::setFont(PSFFont *_font)
+{
+    font = _font;
+    cache.clear();
+}
+
+/*
+ * Returns the pre-rendered bitmap of a glyph, rendering it again only if the
+ * glyph changed since it was cached. Set bits are drawn with the pen color.
+ */
+const QBitmap &QGlyphListWidgetItemDelegate::thumbnail(int index, const PSFGlyph &glyph) const
+{
+    Thumbnail *thumb = cache.object(index);
+    if (thumb != nullptr && thumb->generation == glyph.getGeneration()) {
+        return thumb->bitmap;
+    }
+
+    int glw = static_cast<int>(font->getWidth());
+    int glh = static_cast<int>(font->getHeight());
+    unsigned rowBytes = (font->getWidth() + 7) >> 3;
+    const std::vector<unsigned char> &data = glyph.getData();
+
+    // PSF rows have the same layout as QImage::Format_Mono scanlines
+    QImage img(glw, glh, QImage::Format_Mono);
+    img.setColor(0, qRgb(0xff, 0xff, 0xff));
+    img.setColor(1, qRgb(0x0, 0x0, 0x0));
+    for (int y = 0; y < glh; y++) {
+        uchar *line = img.scanLine(y);
+        if (data.empty()) {
+            memset(line, 0, rowBytes);
+        } else {
+            memcpy(line, &data[static_cast<unsigned>(y) * rowBytes], rowBytes);
+        }
+    }
+
+    thumb = new Thumbnail{glyph.getGeneration(), QBitmap::fromImage(img)};
+    int cost = img.bytesPerLine() * glh + static_cast<int>(sizeof(Thumbnail));
+    cache.insert(index, thumb, cost);
+
+    return thumb->bitmap;
+}
+
 void QGlyphListWidgetItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
 {
     QString itm_text = index.data().toString();
-    QVariant itmv = index.data(Qt::UserRole);
-    PSFGlyph *glyph = itmv.value<PSFGlyph *>();
 
     if (option.state & QStyle::State_Selected) {
         painter->fillRect(option.rect, option.palette.highlight());
     }
 
-    int x, y;
-    size_t glw = glyph->getFont()->getWidth();
-    size_t glh = glyph->getFont()->getHeight();
-
-    int start_x = option.rect.x() + option.fontMetrics.width(itm_text) + 8;
-    int start_y = option.rect.y() + (option.rect.height() - glh) / 2;
-
     QRect r = option.rect;
     r.setX(option.rect.x() + 3);
     painter->drawText(r, Qt::AlignVCenter | Qt::AlignLeft, itm_text);
 
-    y = start_y;
-    for (unsigned gy = 0; gy < glh; gy ++) {
-        x = start_x;
-        for (unsigned gx = 0; gx < glw; gx++) {
-            if (glyph->getPixel(gx, gy) != 0) {
-                painter->drawPoint(x, y);
-            }
-            x++;
-        }
-        y++;
+    if (font == nullptr) {
+        return;
     }
+    int glh = static_cast<int>(font->getHeight());
+    int start_x = option.rect.x() + option.fontMetrics.width(itm_text) + 8;
+    int start_y = option.rect.y() + (option.rect.height() - glh) / 2;
+
+    const PSFGlyph &glyph = font->getGlyph(static_cast<unsigned>(index.row()));
+    painter->drawPixmap(start_x, start_y, thumbnail(index.row(), glyph));
 }
 
 QSize QGlyphListWidgetItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
 {
-    QVariant itmv = index.data(Qt::UserRole);
-    PSFGlyph *glyph = itmv.value<PSFGlyph *>();
-    unsigned gh = glyph->getFont()->getHeight();
+    Q_UNUSED(index);
+
+    int gh = (font != nullptr) ? static_cast<int>(font->getHeight()) : 0;
     int w = option.rect.width();
-    int h = qMax(option.fontMetrics.height() + 4, static_cast<int>(gh) + 4);
+    int h = qMax(option.fontMetrics.height() + 4, gh + 4);
 
     return QSize(w, h);
 }
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QRegion>
+#include <QScrollBar>
+#include "qsampletextview.h"
+
+// Columns between tab stops
+static const int SAMPLE_TAB_SIZE = 8;
+
+QSampleTextView::QSampleTextView(QWidget *parent) :
+    QAbstractScrollArea(parent),
+    font(nullptr),
+    sampleText(DEFAULT_SAMPLE_TEXT),
+    zoom(DEFAULT_SAMPLE_ZOOM),
+    fallbackGlyph(-1)
+{ }
+
+void QSampleTextView::setFont(PSFFont *_font)
+{
+    font = _font;
+    refreshMapping();
+}
+
+void QSampleTextView::setText(const QString &text)
+{
+    if (text == sampleText) {
+        return;
+    }
+    sampleText = text;
+    layoutText();
+}
+
+void QSampleTextView::refreshMapping()
+{
+    glyphOf.clear();
+    fallbackGlyph = -1;
+    if (font != nullptr && font->hasUnicodeTable()) {
+        // Sequences cannot be shown cell by cell, only single values count
+        for (unsigned i = 0; i < font->getNumGlyphs(); ++i) {
+            const std::vector<unsigned int>& vals = font->getGlyph(i).getUnicodeValues();
+            for (size_t k = 0; k < vals.size() && vals[k] != PSF1_STARTSEQ; ++k) {
+                glyphOf.emplace(vals[k], static_cast<int>(i));
+            }
+        }
+    }
+    fallbackGlyph = glyphFor(0xFFFD);
+    if (fallbackGlyph < 0) {
+        fallbackGlyph = glyphFor('?');
+    }
+    layoutText();
+}
+
+void QSampleTextView::updateGlyph(int index)
+{
+    if (img.isNull()) {
+        return;
+    }
+    auto range = std::equal_range(cells.begin(), cells.end(), Cell{index, 0, 0},
+                                  [](const Cell &a, const Cell &b) { return a.glyph < b.glyph; });
+    if (range.first == range.second) {
+        return;
+    }
+
+    QRegion dirty;
+    QRect visible = viewport()->rect();
+    for (auto it = range.first; it != range.second; ++it) {
+        renderCell(*it);
+        QRect r = viewRectOfCell(*it);
+        if (r.intersects(visible)) {
+            dirty += r;
+        }
+    }
+    viewport()->update(dirty);
+}
+
+void QSampleTextView::setZoom(int z)
+{
+    z = qMax(1, z);
+    if (z == zoom) {
+        return;
+    }
+    zoom = z;
+    updateScrollBars();
+    viewport()->update();
+}
+
+int QSampleTextView::glyphFor(unsigned codepoint) const
+{
+    if (font == nullptr) {
+        return -1;
+    }
+    if (!font->hasUnicodeTable()) {
+        // Without a table, glyphs are in code page order
+        return (codepoint < font->getNumGlyphs()) ? static_cast<int>(codepoint) : -1;
+    }
+    auto it = glyphOf.find(codepoint);
+    return (it != glyphOf.end()) ? it->second : -1;
+}
+
+void QSampleTextView::layoutText()
+{
+    cells.clear();
+    img = QImage();
+    if (font == nullptr || font->getNumGlyphs() == 0) {
+        updateScrollBars();
+        viewport()->update();
+        return;
+    }
+
+    int column = 0, line = 0, columns = 0;
+    for (uint cp : sampleText.toUcs4()) {
+        if (cp == '\n') {
+            line++;
+            column = 0;
+            continue;
+        }
+        if (cp == '\r') {
+            continue;
+        }
+        if (cp == '\t') {
+            column = (column / SAMPLE_TAB_SIZE + 1) * SAMPLE_TAB_SIZE;
+        } else {
+            int glyph = glyphFor(cp);
+            if (glyph < 0) {
+                glyph = fallbackGlyph;
+            }
+            // Missing characters stay blank
+            if (glyph >= 0) {
+                cells.push_back({glyph, column, line});
+            }
+            column++;
+        }
+        columns = qMax(columns, column);
+    }
+    std::stable_sort(cells.begin(), cells.end(),
+                     [](const Cell &a, const Cell &b) { return a.glyph < b.glyph; });
+
+    int w = static_cast<int>(font->getWidth());
+    int h = static_cast<int>(font->getHeight());
+    if (columns > 0) {
+        img = QImage(columns * w, (line + 1) * h, QImage::Format_Mono);
+        img.setColor(0, qRgb(0, 43, 54));
+        img.setColor(1, qRgb(255, 140, 0));
+        img.fill(0);
+        for (const Cell &cell : cells) {
+            renderCell(cell);
+        }
+    }
+    updateScrollBars();
+    viewport()->update();
+}
+
+void QSampleTextView::renderCell(const Cell &cell)
+{
+    const std::vector<unsigned char> &data = font->getGlyph(static_cast<unsigned>(cell.glyph)).getData();
+    unsigned w = font->getWidth();
+    unsigned h = font->getHeight();
+    unsigned rowBytes = (w + 7) >> 3;
+    unsigned x0 = static_cast<unsigned>(cell.column) * w;
+    unsigned shift = x0 & 7;
+    uchar tail = static_cast<uchar>(0xFF << (rowBytes * 8 - w));
+
+    // Glyph rows start at any bit of the scanline, so every source byte is
+    // split over two target bytes and merged in under a mask
+    for (unsigned y = 0; y < h; y++) {
+        uchar *dst = img.scanLine(static_cast<int>(static_cast<unsigned>(cell.line) * h + y)) + (x0 >> 3);
+        const unsigned char *src = data.empty() ? nullptr : &data[y * rowBytes];
+        for (unsigned i = 0; i < rowBytes; i++) {
+            uchar mask = (i + 1 == rowBytes) ? tail : 0xFF;
+            uchar v = (src != nullptr) ? (src[i] & mask) : 0;
+            dst[i] = static_cast<uchar>((dst[i] & ~(mask >> shift)) | (v >> shift));
+            uchar spill = static_cast<uchar>(mask << (8 - shift));
+            if (shift != 0 && spill != 0) {
+                dst[i + 1] = static_cast<uchar>((dst[i + 1] & ~spill) | (v << (8 - shift)));
+            }
+        }
+    }
+}
+
+QRect QSampleTextView::viewRectOfCell(const Cell &cell) const
+{
+    int w = static_cast<int>(font->getWidth()) * zoom;
+    int h = static_cast<int>(font->getHeight()) * zoom;
+    return QRect(cell.column * w - horizontalScrollBar()->value(),
+                 cell.line * h - verticalScrollBar()->value(), w, h);
+}
+
+void QSampleTextView::updateScrollBars()
+{
+    QSize content = img.isNull() ? QSize(0, 0) : img.size() * zoom;
+    QSize view = viewport()->size();
+    int lineHeight = (font != nullptr) ? static_cast<int>(font->getHeight()) * zoom : 1;
+
+    horizontalScrollBar()->setRange(0, qMax(0, content.width() - view.width()));
+    horizontalScrollBar()->setPageStep(view.width());
+    horizontalScrollBar()->setSingleStep(lineHeight);
+    verticalScrollBar()->setRange(0, qMax(0, content.height() - view.height()));
+    verticalScrollBar()->setPageStep(view.height());
+    verticalScrollBar()->setSingleStep(lineHeight);
+}
+
+void QSampleTextView::paintEvent(QPaintEvent *e)
+{
+    QPainter painter(viewport());
+    painter.fillRect(e->rect(), QColor(72, 71, 65));
+
+    if (img.isNull()) {
+        return;
+    }
+
+    int sx = horizontalScrollBar()->value();
+    int sy = verticalScrollBar()->value();
+
+    // Image area covered by the exposed rectangle, snapped to whole pixels
+    QRect exposed = e->rect().translated(sx, sy);
+    QRect src(exposed.left() / zoom, exposed.top() / zoom,
+              exposed.width() / zoom + 2, exposed.height() / zoom + 2);
+    src &= img.rect();
+    if (src.isEmpty()) {
+        return;
+    }
+    QRect dst(src.x() * zoom - sx, src.y() * zoom - sy, src.width() * zoom, src.height() * zoom);
+    painter.drawImage(dst, img, src);
+}
+
+void QSampleTextView::resizeEvent(QResizeEvent *e)
+{
+    QAbstractScrollArea::resizeEvent(e);
+    updateScrollBars();
+}